@@ -1,10 +1,43 @@
+#define _GNU_SOURCE // O_DIRECT
 #include "command_processor.h"
 #include "io_access.h"
+#include "output.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define XFER_PATH_MAX 4096
+
+/* Operations collected between "batch" and "end" */
+static io_op_t *batch_ops = NULL;
+static size_t batch_count = 0;
+static size_t batch_capacity = 0;
+static bool batch_open = false;
+
+/* Set by any command that fails or times out, see command_failed() */
+static bool failed = false;
+
+/*
+ * One entry per command. The table drives dispatch, batch collection
+ * and the splitting of one-shot argv into commands.
+ */
+typedef struct command {
+  const char *name;
+  const char *usage;   // arguments, for error messages
+  int min_args;
+  int max_args;
+  // NULL: only valid inside a batch (or handled before dispatch)
+  int (*run)(const struct command *c, const char *const *args, const char *line);
+  int batch_op;        // io_op_kind_t, or -1 if not allowed in a batch
+  uint8_t size;
+} command_t;
 
 static int parse_number(const char *str, uintptr_t *value)
 {
@@ -54,28 +87,7 @@ static int parse_number(const char *str, uintptr_t *value)
     return 0;
 }
 
-static void print_value(const char *cmd, uintptr_t addr,
-      unsigned long val)
-{
-  if (!strcmp(cmd, "iorb"))
-    printf("address 0x%lX: 0x%02lX\n", addr, val & 0xFF);
-  else if (!strcmp(cmd, "iorw"))
-    printf("address 0x%lX: 0x%04lX\n", addr, val & 0xFFFF);
-  else if (!strcmp(cmd, "iord"))
-    printf("address 0x%lX: 0x%08lX\n", addr,val & 0xFFFFFFFF);
-}
-static void print_write_result(const char *cmd, uintptr_t addr,
-      unsigned long val)
-{
-  if (!strcmp(cmd, "iowb"))
-    printf("Write byte 0x%02lX to address 0x%lX\n", val & 0xFF, addr);
-  else if (!strcmp(cmd, "ioww"))
-    printf("Write word 0x%04lX to address 0x%lX\n", val & 0xFFFF, addr);
-  else if (!strcmp(cmd, "iowd"))
-    printf("Write dword 0x%08lX to address 0x%lX\n", val & 0xFFFFFFFF, addr);
-}
-
-static void handle_read_command(const char *cmd, const char *arg,
+static int handle_read_command(const char *cmd, const char *arg,
         uint8_t (*read_byte)(uintptr_t),
         uint16_t (*read_word)(uintptr_t),
         uint32_t (*read_dword)(uintptr_t))
@@ -83,22 +95,31 @@ static void handle_read_command(const char *cmd, const char *arg,
     uintptr_t addr;
     if (parse_number(arg, &addr)) {
     fprintf(stderr, "Invalid address: %s\n", arg);
-    return;
+    return -1;
     }
-	uint64_t val;
     if (!strcmp(cmd, "iorb")) {
-        if (mem_read(addr, 1, &val) == 0)
-            print_value(cmd, addr, read_byte(addr));
+        if (io_probe(addr, 1) == 0) {
+            out_read(addr, 1, read_byte(addr));
+            return 0;
+        }
+        out_error(OUT_OP_READ, addr, 1);
     } else if (!strcmp(cmd, "iorw")) {
-        if (mem_read(addr, 2, &val) == 0)
-            print_value(cmd, addr, read_word(addr));
+        if (io_probe(addr, 2) == 0) {
+            out_read(addr, 2, read_word(addr));
+            return 0;
+        }
+        out_error(OUT_OP_READ, addr, 2);
     } else if (!strcmp(cmd, "iord")) {
-        if (mem_read(addr, 4, &val) == 0)
-            print_value(cmd, addr, read_dword(addr));
+        if (io_probe(addr, 4) == 0) {
+            out_read(addr, 4, read_dword(addr));
+            return 0;
+        }
+        out_error(OUT_OP_READ, addr, 4);
     }
+    return -1;
 }
 
-static void handle_write_command(const char *cmd, const char *arg1,
+static int handle_write_command(const char *cmd, const char *arg1,
          const char *arg2,
          void (*write_byte)(uintptr_t, uint8_t),
          void (*write_word)(uintptr_t, uint16_t),
@@ -107,35 +128,458 @@ static void handle_write_command(const char *cmd, const char *arg1,
   uintptr_t addr, data;
   if (parse_number(arg1, &addr)) {
     fprintf(stderr, "Invalid address: %s\n", arg1);
-    return;
+    return -1;
   }
   if (parse_number(arg2, &data)) {
     fprintf(stderr, "Invalid data: %s\n", arg2);
-    return;
+    return -1;
   }
-  uint64_t val;
   if (!strcmp(cmd, "iowb")) {
-      if (mem_read(addr, 1, &val) == 0) {
+      if (io_probe(addr, 1) == 0) {
           write_byte(addr, (uint8_t)data);
-          print_write_result(cmd, addr, data);
+          out_write(addr, 1, (uint8_t)data);
+          return 0;
       }
+      out_error(OUT_OP_WRITE, addr, 1);
   } else if (!strcmp(cmd, "ioww")) {
-      if (mem_read(addr, 2, &val) == 0) {
+      if (io_probe(addr, 2) == 0) {
           write_word(addr, (uint16_t)data);
-          print_write_result(cmd, addr, data);
+          out_write(addr, 2, (uint16_t)data);
+          return 0;
       }
+      out_error(OUT_OP_WRITE, addr, 2);
   } else if (!strcmp(cmd, "iowd")) {
-      if (mem_read(addr, 4, &val) == 0) {
+      if (io_probe(addr, 4) == 0) {
           write_dword(addr, (uint32_t)data);
-          print_write_result(cmd, addr, data);
+          out_write(addr, 4, (uint32_t)data);
+          return 0;
       }
+      out_error(OUT_OP_WRITE, addr, 4);
+  }
+  return -1;
+}
+
+static int handle_wait_command(const char *arg1, const char *arg2,
+        const char *arg3, const char *arg4, const char *arg5)
+{
+  uintptr_t addr, mask, value, timeout_us, width = 1;
+  if (parse_number(arg1, &addr)) {
+    fprintf(stderr, "Invalid address: %s\n", arg1);
+    return -1;
+  }
+  if (parse_number(arg2, &mask)) {
+    fprintf(stderr, "Invalid mask: %s\n", arg2);
+    return -1;
+  }
+  if (parse_number(arg3, &value)) {
+    fprintf(stderr, "Invalid value: %s\n", arg3);
+    return -1;
+  }
+  if (parse_number(arg4, &timeout_us)) {
+    fprintf(stderr, "Invalid timeout: %s\n", arg4);
+    return -1;
+  }
+  if (arg5 && (parse_number(arg5, &width) ||
+      (width != 1 && width != 2 && width != 4))) {
+    fprintf(stderr, "Invalid width: %s (expected 1, 2 or 4)\n", arg5);
+    return -1;
+  }
+  uint64_t elapsed_ns;
+  int ret;
+  if (width == 1)
+    ret = io_wait_byte(addr, (uint8_t)mask, (uint8_t)value, timeout_us, &elapsed_ns);
+  else if (width == 2)
+    ret = io_wait_word(addr, (uint16_t)mask, (uint16_t)value, timeout_us, &elapsed_ns);
+  else
+    ret = io_wait_dword(addr, (uint32_t)mask, (uint32_t)value, timeout_us, &elapsed_ns);
+  if (ret < 0) {
+    out_error(OUT_OP_WAIT, addr, width);
+    return -1;
+  }
+  out_wait(addr, width, ret == 0 ? OUT_STATUS_OK : OUT_STATUS_TIMEOUT, elapsed_ns);
+  return ret;
+}
+
+static int batch_add(const command_t *c, int argc, const char *const *args)
+{
+  io_op_t op = { .op = (uint8_t)c->batch_op, .size = c->size };
+  uintptr_t val[4] = {0};
+
+  for (int i = 0; i < c->min_args; i++) {
+    if (parse_number(args[i], &val[i])) {
+      fprintf(stderr, "Invalid argument: %s\n", args[i]);
+      return -1;
+    }
+  }
+  if (op.op == IO_OP_WAIT && argc > 4) {
+    uintptr_t width;
+    if (parse_number(args[4], &width) ||
+        (width != 1 && width != 2 && width != 4)) {
+      fprintf(stderr, "Invalid width: %s (expected 1, 2 or 4)\n", args[4]);
+      return -1;
+    }
+    op.size = (uint8_t)width;
+  }
+
+  switch (op.op) {
+  case IO_OP_DELAY:
+    op.timeout_us = val[0];
+    break;
+  case IO_OP_MODIFY:
+    op.addr = val[0];
+    op.mask = (uint32_t)val[1];
+    op.value = (uint32_t)val[2];
+    break;
+  case IO_OP_WAIT:
+    op.addr = val[0];
+    op.mask = (uint32_t)val[1];
+    op.value = (uint32_t)val[2];
+    op.timeout_us = val[3];
+    break;
+  default:
+    op.addr = val[0];
+    op.value = (uint32_t)val[1];
+    break;
+  }
+
+  if (batch_count == batch_capacity) {
+    size_t new_capacity = batch_capacity ? batch_capacity * 2 : 64;
+    io_op_t *ops = realloc(batch_ops, new_capacity * sizeof(*ops));
+    if (!ops) {
+      fprintf(stderr, "Out of memory, operation dropped\n");
+      return -1;
+    }
+    batch_ops = ops;
+    batch_capacity = new_capacity;
+  }
+  batch_ops[batch_count++] = op;
+  return 0;
+}
+
+static void batch_reset(void)
+{
+  free(batch_ops);
+  batch_ops = NULL;
+  batch_count = 0;
+  batch_capacity = 0;
+  batch_open = false;
+}
+
+static int batch_run(void)
+{
+  int ret = 0;
+
+  io_result_t *results = calloc(batch_count ? batch_count : 1, sizeof(*results));
+  if (!results) {
+    fprintf(stderr, "Out of memory, batch discarded\n");
+    batch_reset();
+    return -1;
+  }
+  size_t done = io_batch(io_default_ctx(), batch_ops, batch_count, results);
+  // Report every executed operation, including a wait that timed out
+  size_t reported = done < batch_count ? done + 1 : done;
+  for (size_t i = 0; i < reported; i++) {
+    const io_op_t *op = &batch_ops[i];
+    const io_result_t *res = &results[i];
+    if (res->status < 0) {
+      if (op->op != IO_OP_DELAY)
+        out_error(op->op == IO_OP_READ ? OUT_OP_READ :
+                  op->op == IO_OP_WAIT ? OUT_OP_WAIT : OUT_OP_WRITE,
+                  op->addr, op->size);
+      break;
+    }
+    if (op->op == IO_OP_READ)
+      out_read(op->addr, op->size, res->value);
+    else if (op->op == IO_OP_WRITE || op->op == IO_OP_MODIFY)
+      out_write(op->addr, op->size, res->value);
+    else if (op->op == IO_OP_WAIT)
+      out_wait(op->addr, op->size,
+               res->status == 0 ? OUT_STATUS_OK : OUT_STATUS_TIMEOUT, res->elapsed_ns);
+  }
+  if (done < batch_count) {
+    fprintf(stderr, "Batch stopped at operation %zu of %zu\n", done + 1, batch_count);
+    ret = -1;
+  }
+  free(results);
+  batch_reset();
+  return ret;
+}
+
+static uint64_t ns_since(const struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - start->tv_sec) * 1000000000ull +
+         (uint64_t)now.tv_nsec - (uint64_t)start->tv_nsec;
+}
+
+static int parse_direct_option(int count, int needed, const char *opt,
+        bool *direct)
+{
+  *direct = false;
+  if (count <= needed)
+    return 0;
+  if (strcmp(opt, "direct")) {
+    fprintf(stderr, "Unknown option: %s\n", opt);
+    return -1;
+  }
+  *direct = true;
+  return 0;
+}
+
+static int handle_save_command(const char *line)
+{
+  char addr_str[32], len_str[32], path[XFER_PATH_MAX], opt[8];
+  uintptr_t addr, len;
+  bool direct;
+  int fd = STDOUT_FILENO;
+
+  int count = sscanf(line, "%*s %31s %31s %4095s %7s", addr_str, len_str, path, opt);
+  if (count < 3) {
+    fprintf(stderr, "Usage: iosave <addr> <len> <file|-> [direct]\n");
+    return -1;
+  }
+  if (parse_number(addr_str, &addr)) {
+    fprintf(stderr, "Invalid address: %s\n", addr_str);
+    return -1;
+  }
+  if (parse_number(len_str, &len)) {
+    fprintf(stderr, "Invalid length: %s\n", len_str);
+    return -1;
+  }
+  if (parse_direct_option(count, 3, opt, &direct))
+    return -1;
+
+  if (strcmp(path, "-")) {
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | (direct ? O_DIRECT : 0), 0644);
+    if (fd < 0) {
+      perror(path);
+      return -1;
+    }
+  } else {
+    direct = false;
+    out_flush();
+  }
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int64_t done = io_ctx_save(io_default_ctx(), addr, len, fd,
+                             direct ? IO_XFER_DIRECT : 0);
+  if (fd != STDOUT_FILENO)
+    close(fd);
+  // Data went to stdout, so the record has to go to stderr
+  out_transfer(OUT_OP_SAVE, addr, done > 0 ? (uint64_t)done : 0,
+               done >= 0 ? OUT_STATUS_OK : OUT_STATUS_ERROR, ns_since(&start),
+               fd == STDOUT_FILENO);
+  return done >= 0 ? 0 : -1;
+}
+
+static int handle_load_command(const char *line)
+{
+  char path[XFER_PATH_MAX], addr_str[32], extra[2][32];
+  uintptr_t addr, len = 0;
+  bool direct = false, have_len = false;
+  int fd = STDIN_FILENO;
+  struct stat st;
+
+  int count = sscanf(line, "%*s %4095s %31s %31s %31s", path, addr_str,
+                     extra[0], extra[1]);
+  if (count < 2) {
+    fprintf(stderr, "Usage: ioload <file|-> <addr> [len] [direct]\n");
+    return -1;
+  }
+  if (parse_number(addr_str, &addr)) {
+    fprintf(stderr, "Invalid address: %s\n", addr_str);
+    return -1;
+  }
+  for (int i = 0; i < count - 2; i++) {
+    if (!have_len && !direct && !parse_number(extra[i], &len)) {
+      have_len = true;
+    } else if (parse_direct_option(1, 0, extra[i], &direct)) {
+      return -1;
+    }
+  }
+
+  if (strcmp(path, "-")) {
+    fd = open(path, O_RDONLY | (direct ? O_DIRECT : 0));
+    if (fd < 0) {
+      perror(path);
+      return -1;
+    }
+  } else {
+    direct = false;
+  }
+  // Regular files are loaded whole or up to len; pipes need an explicit
+  // len so stdin can never write past the intended range
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    if (!have_len || (uintptr_t)st.st_size < len)
+      len = (uintptr_t)st.st_size;
+  } else if (!have_len) {
+    fprintf(stderr, "ioload from a pipe or device needs a length\n");
+    if (fd != STDIN_FILENO)
+      close(fd);
+    return -1;
+  }
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int64_t done = io_ctx_load(io_default_ctx(), fd, addr, len,
+                             direct ? IO_XFER_DIRECT : 0);
+  if (fd != STDIN_FILENO)
+    close(fd);
+  out_transfer(OUT_OP_LOAD, addr, done > 0 ? (uint64_t)done : 0,
+               done >= 0 ? OUT_STATUS_OK : OUT_STATUS_ERROR, ns_since(&start), 0);
+  return done >= 0 ? 0 : -1;
+}
+
+static int run_read(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)line;
+  return handle_read_command(c->name, args[0], io_read_byte, io_read_word,
+                             io_read_dword);
+}
+
+static int run_write(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)line;
+  return handle_write_command(c->name, args[0], args[1], io_write_byte,
+                              io_write_word, io_write_dword);
+}
+
+static int run_wait(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)c;
+  (void)line;
+  return handle_wait_command(args[0], args[1], args[2], args[3], args[4]);
+}
+
+static int run_save(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)c;
+  (void)args;
+  return handle_save_command(line);
+}
+
+static int run_load(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)c;
+  (void)args;
+  return handle_load_command(line);
+}
+
+static int run_batch(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)c;
+  (void)args;
+  (void)line;
+  batch_open = true;
+  return 0;
+}
+
+static int run_help(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)c;
+  (void)args;
+  (void)line;
+  print_help();
+  return 0;
+}
+
+static int run_flush(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)c;
+  (void)args;
+  (void)line;
+  out_flush();
+  return 0;
+}
+
+static int run_output(const command_t *c, const char *const *args,
+        const char *line)
+{
+  (void)line;
+  if (out_set_mode(args[0])) {
+    fprintf(stderr, "Usage: %s %s\n", c->name, c->usage);
+    return -1;
+  }
+  return 0;
+}
+
+static const command_t commands[] = {
+  { "iorb",   "<addr>", 1, 1, run_read, IO_OP_READ, 1 },
+  { "iorw",   "<addr>", 1, 1, run_read, IO_OP_READ, 2 },
+  { "iord",   "<addr>", 1, 1, run_read, IO_OP_READ, 4 },
+  { "iowb",   "<addr> <data>", 2, 2, run_write, IO_OP_WRITE, 1 },
+  { "ioww",   "<addr> <data>", 2, 2, run_write, IO_OP_WRITE, 2 },
+  { "iowd",   "<addr> <data>", 2, 2, run_write, IO_OP_WRITE, 4 },
+  { "iomb",   "<addr> <mask> <value>", 3, 3, NULL, IO_OP_MODIFY, 1 },
+  { "iomw",   "<addr> <mask> <value>", 3, 3, NULL, IO_OP_MODIFY, 2 },
+  { "iomd",   "<addr> <mask> <value>", 3, 3, NULL, IO_OP_MODIFY, 4 },
+  { "iowait", "<addr> <mask> <value> <timeout_us> [width]", 4, 5, run_wait, IO_OP_WAIT, 1 },
+  { "delay",  "<us>", 1, 1, NULL, IO_OP_DELAY, 0 },
+  { "iosave", "<addr> <len> <file|-> [direct]", 3, 4, run_save, -1, 0 },
+  { "ioload", "<file|-> <addr> [len] [direct]", 2, 4, run_load, -1, 0 },
+  { "batch",  "", 0, 0, run_batch, -1, 0 },
+  { "end",    "", 0, 0, NULL, -1, 0 },
+  { "cancel", "", 0, 0, NULL, -1, 0 },
+  { "output", "text|jsonl|csv|bin", 1, 1, run_output, -1, 0 },
+  { "flush",  "", 0, 0, run_flush, -1, 0 },
+  { "help",   "", 0, 0, run_help, -1, 0 },
+  { "quit",   "", 0, 0, NULL, -1, 0 },
+  { "exit",   "", 0, 0, NULL, -1, 0 },
+};
+
+static const command_t *find_command(const char *name)
+{
+  for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+    if (!strcmp(name, commands[i].name))
+      return &commands[i];
   }
+  return NULL;
+}
+
+static int dispatch(const char *cmd, int argc, const char *const *args,
+        const char *line)
+{
+  const command_t *c = find_command(cmd);
+
+  if (batch_open) {
+    if (!strcmp(cmd, "end"))
+      return batch_run();
+    if (!strcmp(cmd, "cancel")) {
+      batch_reset();
+      return 0;
+    }
+    if (!c || c->batch_op < 0) {
+      fprintf(stderr, "Unknown batch command: %s. Use 'end' to run or 'cancel' to discard.\n", cmd);
+      return -1;
+    }
+  } else if (!c) {
+    fprintf(stderr, "Unknown command: %s. Type 'help' for available commands.\n", cmd);
+    return -1;
+  } else if (!c->run) {
+    fprintf(stderr, "%s is only valid inside a batch\n", cmd);
+    return -1;
+  }
+  if (argc < c->min_args || argc > c->max_args) {
+    fprintf(stderr, "Usage: %s %s\n", c->name, c->usage);
+    return -1;
+  }
+  return batch_open ? batch_add(c, argc, args) : c->run(c, args, line);
 }
 
 int process_command(const char *line)
 {
-  char cmd[8], arg1[32], arg2[32];
-  int count;
+  char cmd[8], arg1[32], arg2[32], arg3[32], arg4[32], arg5[32];
+  int count, words = 0;
 
   while (isspace(*line))
     line++;
@@ -150,46 +594,70 @@ to 8 and 32 respectively, 8 fits our commands, 32 is taken with a margin,
 the maximum 64-bit decimal number takes up 20 characters. 
 For the beauty of the code, values that are multiples of two are taken
 */
-  count = sscanf(line, "%7s %31s %31s", cmd, arg1, arg2);
+  count = sscanf(line, "%7s %31s %31s %31s %31s %31s",
+                 cmd, arg1, arg2, arg3, arg4, arg5);
+  // Argument count by words, sscanf splits words longer than the buffers
+  for (const char *p = line; *p; ) {
+    while (isspace((unsigned char)*p))
+      p++;
+    if (!*p)
+      break;
+    words++;
+    while (*p && !isspace((unsigned char)*p))
+      p++;
+  }
+  if (count > words)
+    count = words;
 
   if (!strcmp(cmd, "quit") || !strcmp(cmd, "exit"))
     return 1;
-  if (!strcmp(cmd, "help")) {
-    print_help();
-    return 0;
-  }
 
-  if (!strcmp(cmd, "iorb") || !strcmp(cmd, "iorw") || !strcmp(cmd, "iord")) {
-    if (count < 2) {
-      fprintf(stderr, "Missing address argument for %s\n", cmd);
-      return 0;
-    }
-    handle_read_command(cmd, arg1, io_read_byte, io_read_word, io_read_dword);
-    return 0;
-  }
+  const char *const args[] = {
+    count > 1 ? arg1 : NULL, count > 2 ? arg2 : NULL, count > 3 ? arg3 : NULL,
+    count > 4 ? arg4 : NULL, count > 5 ? arg5 : NULL,
+  };
+  if (dispatch(cmd, words - 1, args, line))
+    failed = true;
+  return 0;
+}
 
-  if (!strcmp(cmd, "iowb") || !strcmp(cmd, "ioww") || !strcmp(cmd, "iowd")) {
-    if (count < 3) {
-      fprintf(stderr, "Missing address or data argument for %s\n", cmd);
-      return 0;
-    }
-    handle_write_command(cmd, arg1, arg2, io_write_byte, io_write_word, io_write_dword);
-    return 0;
-  }
+int command_args(const char *name, int *max_args)
+{
+  const command_t *c = find_command(name);
 
-  fprintf(stderr, "Unknown command: %s. Type 'help' for available commands.\n", cmd);
-  return 0;
+  if (!c)
+    return -1;
+  if (max_args)
+    *max_args = c->max_args;
+  return c->min_args;
+}
+
+bool command_failed(void)
+{
+  return failed;
+}
+
+bool batch_pending(void)
+{
+  return batch_open;
 }
 
 void print_help(void)
 {
-  printf("Available commands:\n"
+  fprintf(out_text_stream(), "Available commands:\n"
          " iorb <addr> - Read byte from IO address\n"
          " iorw <addr> - Read word from IO address\n"
          " iord <addr> - Read double word from IO address\n"
          " iowb <addr> <data> - Write byte to IO address\n"
          " ioww <addr> <data> - Write word to IO address\n"
          " iowd <addr> <data> - Write double word to IO address\n"
+         " iowait <addr> <mask> <value> <timeout_us> [width] - Wait until (data & mask) == value, width 1/2/4 (default 1)\n"
+         " iosave <addr> <len> <file|-> [direct] - Stream a memory region to a file or stdout\n"
+         " ioload <file|-> <addr> [len] [direct] - Stream a file or stdin into memory (len required for stdin)\n"
+         " batch - Collect the following commands and run them in one pass on 'end'\n"
+         "   (iorX, iowX, iomX <addr> <mask> <value>, iowait, delay <us>; 'cancel' discards)\n"
+         " output <text|jsonl|csv|bin> - Select the result output format\n"
+         " flush - Write out buffered results\n"
          " help - Show this help message\n"
          " quit|exit - Exit the program\n"
          "\nAddress and data can be specified in decimal, octal (prefix 0) or hexadecimal (prefix 0x)\n");
@@ -1,8 +1,22 @@
 #ifndef COMMAND_PROCESSOR_H
 #define COMMAND_PROCESSOR_H
 
+#include <stdbool.h>
+
 int process_command(const char* line);
 
+/*
+ * Minimum number of arguments of command name, -1 if name is not a
+ * command. max_args (may be NULL) receives the maximum.
+ */
+int command_args(const char *name, int *max_args);
+
+/* True once any command has failed or a wait has timed out */
+bool command_failed(void);
+
+/* True while commands are being collected between "batch" and "end" */
+bool batch_pending(void);
+
 void print_help(void);
 
 #endif /* COMMAND_PROCESSOR_H */
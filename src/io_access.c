@@ -1,4 +1,6 @@
+#define _GNU_SOURCE // O_DIRECT
 #include "io_access.h"
+#include "io_sim.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -7,12 +9,38 @@
 #include <sys/io.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
 #define PAGE_SIZE  4096 // Standard memory page size for x86 systems
 #define PORT_MASK  0xFFFF // Maximum address for port-mapped I/O
+#define MAP_CACHE_SIZE  16 // Pages kept mapped per context, direct-mapped
+#define XFER_CHUNK  (4 * 1024 * 1024) // Mapping window of io_ctx_save/load
 
-static int  dev_mem_fd = -1;
-static bool  has_port_access = false;
+#define WAIT_SPIN_NS       20000   // Busy-poll window before io_wait starts sleeping
+#define WAIT_SLEEP_MIN_NS  1000    // First sleep interval of the backoff
+#define WAIT_SLEEP_MAX_NS  1000000 // Backoff ceiling, bounds the wake-up latency
+
+typedef struct {
+  uintptr_t page;  // physical page base
+  void *map;       // NULL while the slot is empty
+} map_entry_t;
+
+/*
+ * Everything an access needs lives here, so two contexts never share
+ * state and a context used by a single thread needs no locking.
+ */
+struct io_ctx {
+  int mem_fd;
+  bool has_port_access;
+  unsigned pending;  // IO_CTX_* backends deferred until first use
+  char *mem_path;    // opened on first memory access when pending
+  io_sim_t *sim;   // When set, every access goes to the model
+  map_entry_t cache[MAP_CACHE_SIZE];
+  io_stats_t stats;
+};
+
+// Context behind the global io_* API
+static io_ctx_t default_ctx = { .mem_fd = -1 };
 
 static inline bool is_port_address(uintptr_t addr)
 {
@@ -29,151 +57,766 @@ static inline size_t get_page_offset(uintptr_t addr)
   return addr & (PAGE_SIZE - 1);
 }
 
-// Map physical memory address to process virtual address space
-static void *map_addr(uintptr_t addr, int prot)
+static bool ctx_open_mem(io_ctx_t *ctx, const char *mem_path)
+{
+  ctx->mem_fd = open(mem_path ? mem_path : "/dev/mem", O_RDWR | O_SYNC);
+  return ctx->mem_fd >= 0;
+}
+
+// Backends of an IO_CTX_LAZY context are set up here, one attempt each
+static void ctx_open_pending(io_ctx_t *ctx, unsigned what)
+{
+  what &= ctx->pending;
+  ctx->pending &= ~what;
+  if ((what & IO_CTX_PORT_IO) && iopl(3) == 0)
+    ctx->has_port_access = true;
+  if ((what & IO_CTX_LAZY) && !ctx_open_mem(ctx, ctx->mem_path))
+    fprintf(stderr, "Failed to open %s: %s\n",
+      ctx->mem_path ? ctx->mem_path : "/dev/mem", strerror(errno));
+}
+
+static inline bool use_port(io_ctx_t *ctx, uintptr_t addr)
+{
+  if (!is_port_address(addr))
+    return false;
+  if (ctx->pending & IO_CTX_PORT_IO)
+    ctx_open_pending(ctx, IO_CTX_PORT_IO);
+  return ctx->has_port_access;
+}
+
+static inline int mem_fd(io_ctx_t *ctx)
+{
+  if (ctx->pending & IO_CTX_LAZY)
+    ctx_open_pending(ctx, IO_CTX_LAZY);
+  return ctx->mem_fd;
+}
+
+static inline bool valid_size(size_t size)
+{
+  return size == 1 || size == 2 || size == 4;
+}
+
+// Map physical memory address to process virtual address space.
+// The page stays mapped in the context cache until its slot is reused.
+static volatile void *map_addr(io_ctx_t *ctx, uintptr_t addr)
 {
   uintptr_t page_base = align_to_page(addr);
+  map_entry_t *entry = &ctx->cache[(page_base / PAGE_SIZE) % MAP_CACHE_SIZE];
+
+  if (entry->map && entry->page == page_base) {
+    ctx->stats.map_hits++;
+    return (volatile void *)((uintptr_t)entry->map + get_page_offset(addr));
+  }
+  ctx->stats.map_misses++;
 
-  void *map = mmap(NULL, PAGE_SIZE, prot, MAP_SHARED,
-       dev_mem_fd, page_base);	// Map entire page containing the target address
+  void *map = mmap(NULL, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+       mem_fd(ctx), page_base);	// Map entire page containing the target address
   if (map == MAP_FAILED) {
     fprintf(stderr, "Failed to map memory at 0x%lx: %s\n",
       (unsigned long)addr, strerror(errno));
     return NULL;
   }
+  if (entry->map)
+    munmap(entry->map, PAGE_SIZE);
+  entry->map = map;
+  entry->page = page_base;
 
-  return map;
+  return (volatile void *)((uintptr_t)map + get_page_offset(addr));
 }
 
-int mem_read(uintptr_t addr, size_t size, uint64_t *out_val)
+static inline uint32_t port_read(uintptr_t addr, size_t size)
 {
-  void *map = map_addr(addr, PROT_READ);
-  if (!map)
-      return -1;
-  off_t offset = get_page_offset(addr);
   switch (size) {
   case 1:
-      *out_val = *((volatile uint8_t *)((uintptr_t)map + offset));
-      break;
+    return inb(addr);
   case 2:
-      *out_val = *((volatile uint16_t *)((uintptr_t)map + offset));
-      break;
-  case 4:
-      *out_val = *((volatile uint32_t *)((uintptr_t)map + offset));
-      break;
-   default:
-      fprintf(stderr, "Unsupported read size %zu\n", size);
-      munmap(map, PAGE_SIZE);
-      return -1;
+    return inw(addr);
+  default:
+    return inl(addr);
   }
-  munmap(map, PAGE_SIZE);
-  return 0;
 }
 
-static inline void mem_write(uintptr_t addr, uint64_t value, size_t size)
+static inline void port_write(uintptr_t addr, size_t size, uint32_t value)
 {
-  void *map = map_addr(addr, PROT_READ | PROT_WRITE);
-  if (!map)
-    return;
+  switch (size) {
+  case 1:
+    outb(value, addr);
+    break;
+  case 2:
+    outw(value, addr);
+    break;
+  default:
+    outl(value, addr);
+    break;
+  }
+}
+
+static inline uint32_t reg_read(volatile void *reg, size_t size)
+{
+  switch (size) {
+  case 1:
+    return *(volatile uint8_t *)reg;
+  case 2:
+    return *(volatile uint16_t *)reg;
+  default:
+    return *(volatile uint32_t *)reg;
+  }
+}
 
-  off_t offset = get_page_offset(addr);
 // volatile is required for MMIO: prevents the compiler from reordering
 // or optimizing away accesses to device registers.
+static inline void reg_write(volatile void *reg, size_t size, uint32_t value)
+{
   switch (size) {
   case 1:
-    *((volatile uint8_t *)((uintptr_t)map + offset)) = (uint8_t)value;
+    *(volatile uint8_t *)reg = (uint8_t)value;
     break;
   case 2:
-    *((volatile uint16_t *)((uintptr_t)map + offset)) = (uint16_t)value;
-    break;
-  case 4:
-    *((volatile uint32_t *)((uintptr_t)map + offset)) = (uint32_t)value;
+    *(volatile uint16_t *)reg = (uint16_t)value;
     break;
   default:
+    *(volatile uint32_t *)reg = value;
+    break;
+  }
+}
+
+// Memory (or simulated) read that never goes through port I/O
+static int ctx_mem_read(io_ctx_t *ctx, uintptr_t addr, size_t size,
+      uint32_t *out_val)
+{
+  if (ctx->sim)
+    return io_sim_read(ctx->sim, addr, size, out_val);
+  volatile void *reg = map_addr(ctx, addr);
+  if (!reg)
+    return -1;
+  *out_val = reg_read(reg, size);
+  return 0;
+}
+
+static int ctx_mem_write(io_ctx_t *ctx, uintptr_t addr, size_t size,
+       uint32_t value)
+{
+  if (ctx->sim)
+    return io_sim_write(ctx->sim, addr, size, value);
+  volatile void *reg = map_addr(ctx, addr);
+  if (!reg)
+    return -1;
+  reg_write(reg, size, value);
+  return 0;
+}
+
+static void ctx_release(io_ctx_t *ctx)
+{
+  for (size_t i = 0; i < MAP_CACHE_SIZE; i++) {
+    if (ctx->cache[i].map)
+      munmap(ctx->cache[i].map, PAGE_SIZE);
+  }
+  if (ctx->mem_fd >= 0)
+    close(ctx->mem_fd);
+  io_sim_free(ctx->sim);
+  free(ctx->mem_path);
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->mem_fd = -1;
+}
+
+static bool ctx_setup(io_ctx_t *ctx, const char *mem_path, unsigned flags)
+{
+  if (flags & IO_CTX_LAZY) {
+    if (mem_path && !(ctx->mem_path = strdup(mem_path)))
+      return false;
+    ctx->pending = (flags & IO_CTX_PORT_IO) | IO_CTX_LAZY;
+    return true;
+  }
+
+  if ((flags & IO_CTX_PORT_IO) && iopl(3) == 0)
+    ctx->has_port_access = true;
+
+  if (!ctx_open_mem(ctx, mem_path))
+    return ctx->has_port_access;
+
+  return true;
+}
+
+io_ctx_t *io_ctx_open(const char *mem_path, unsigned flags)
+{
+  io_ctx_t *ctx = calloc(1, sizeof(*ctx));
+  if (!ctx)
+    return NULL;
+  ctx->mem_fd = -1;
+  if (!ctx_setup(ctx, mem_path, flags)) {
+    free(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+io_ctx_t *io_ctx_open_sim(const char *config_path)
+{
+  io_ctx_t *ctx = calloc(1, sizeof(*ctx));
+  if (!ctx)
+    return NULL;
+  ctx->mem_fd = -1;
+  ctx->sim = io_sim_load(config_path);
+  if (!ctx->sim) {
+    free(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+void io_ctx_close(io_ctx_t *ctx)
+{
+  if (!ctx)
+    return;
+  ctx_release(ctx);
+  free(ctx);
+}
+
+void io_ctx_stats(const io_ctx_t *ctx, io_stats_t *stats)
+{
+  *stats = ctx->stats;
+}
+
+int io_ctx_read(io_ctx_t *ctx, uintptr_t addr, size_t size, uint32_t *out_val)
+{
+  if (!valid_size(size)) {
+    fprintf(stderr, "Unsupported read size %zu\n", size);
+    ctx->stats.errors++;
+    return -1;
+  }
+  ctx->stats.reads++;
+  if (!ctx->sim && use_port(ctx, addr)) {
+    *out_val = port_read(addr, size); // Use port I/O if available and address is in port range
+    return 0;
+  }
+  if (ctx_mem_read(ctx, addr, size, out_val)) {
+    ctx->stats.errors++;
+    return -1;
+  }
+  return 0;
+}
+
+int io_ctx_write(io_ctx_t *ctx, uintptr_t addr, size_t size, uint32_t value)
+{
+  if (!valid_size(size)) {
     fprintf(stderr, "Unsupported write size %zu\n", size);
+    ctx->stats.errors++;
+    return -1;
   }
+  ctx->stats.writes++;
+  if (!ctx->sim && use_port(ctx, addr)) {
+    port_write(addr, size, value);
+    return 0;
+  }
+  if (ctx_mem_write(ctx, addr, size, value)) {
+    ctx->stats.errors++;
+    return -1;
+  }
+  return 0;
+}
 
-  munmap(map, PAGE_SIZE);
+// Check that addr can be accessed without touching the register itself
+int io_ctx_probe(io_ctx_t *ctx, uintptr_t addr, size_t size)
+{
+  if (!valid_size(size))
+    return -1;
+  if (ctx->sim)
+    return io_sim_probe(ctx->sim, addr);
+  if (use_port(ctx, addr))
+    return 0;
+  return map_addr(ctx, addr) ? 0 : -1;
 }
 
-bool io_init(void)
+int io_ctx_region_map(io_ctx_t *ctx, io_region_t *region, uintptr_t phys,
+      size_t len)
+{
+  if (ctx->sim) {
+    fprintf(stderr, "Regions cannot be mapped on a simulated device\n");
+    return -1;
+  }
+  if (!len) {
+    fprintf(stderr, "Empty region at 0x%lx\n", (unsigned long)phys);
+    return -1;
+  }
+  uintptr_t page_base = align_to_page(phys);
+  size_t map_len = (get_page_offset(phys) + len + PAGE_SIZE - 1) & ~(size_t)(PAGE_SIZE - 1);
+  void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+       mem_fd(ctx), page_base);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Failed to map region at 0x%lx: %s\n",
+      (unsigned long)phys, strerror(errno));
+    return -1;
+  }
+  region->map = map;
+  region->map_len = map_len;
+  region->base = (volatile uint8_t *)map + get_page_offset(phys);
+  region->phys = phys;
+  region->len = len;
+  return 0;
+}
+
+void io_region_unmap(io_region_t *region)
+{
+  if (region->map) {
+    munmap(region->map, region->map_len);
+    region->map = NULL;
+    region->base = NULL;
+  }
+}
+
+static int write_all(int fd, const volatile void *buf, size_t len)
+{
+  const uint8_t *p = (const uint8_t *)buf;
+
+  while (len) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("write");
+      return -1;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+// Returns the number of bytes read, short only at end of file
+static ssize_t read_full(int fd, volatile void *buf, size_t len)
+{
+  uint8_t *p = (uint8_t *)buf;
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t n = read(fd, p + done, len - done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("read");
+      return -1;
+    }
+    if (n == 0)
+      break;
+    done += (size_t)n;
+  }
+  return (ssize_t)done;
+}
+
+// O_DIRECT needs block sized transfers, the unaligned tail goes through the cache
+static void drop_direct_if_unaligned(int fd, size_t len)
+{
+  if (len % PAGE_SIZE) {
+    int fl = fcntl(fd, F_GETFL);
+    if (fl >= 0)
+      fcntl(fd, F_SETFL, fl & ~O_DIRECT);
+  }
+}
+
+int64_t io_ctx_save(io_ctx_t *ctx, uintptr_t phys, size_t len, int fd,
+     unsigned flags)
+{
+  void *bounce = NULL;
+  size_t done = 0;
+
+  if ((flags & IO_XFER_DIRECT) && posix_memalign(&bounce, PAGE_SIZE, XFER_CHUNK)) {
+    fprintf(stderr, "Failed to allocate transfer buffer\n");
+    return -1;
+  }
+  while (done < len) {
+    io_region_t region;
+    size_t n = len - done < XFER_CHUNK ? len - done : XFER_CHUNK;
+    int ret;
+
+    if (io_ctx_region_map(ctx, &region, phys + done, n))
+      break;
+    if (bounce) {
+      drop_direct_if_unaligned(fd, n);
+      memcpy(bounce, (const void *)region.base, n);
+      ret = write_all(fd, bounce, n);
+    } else {
+      ret = write_all(fd, region.base, n);
+    }
+    io_region_unmap(&region);
+    if (ret)
+      break;
+    done += n;
+  }
+  free(bounce);
+  return done == len ? (int64_t)done : -1;
+}
+
+int64_t io_ctx_load(io_ctx_t *ctx, int fd, uintptr_t phys, size_t len,
+     unsigned flags)
+{
+  void *bounce = NULL;
+  size_t done = 0;
+
+  if ((flags & IO_XFER_DIRECT) && posix_memalign(&bounce, PAGE_SIZE, XFER_CHUNK)) {
+    fprintf(stderr, "Failed to allocate transfer buffer\n");
+    return -1;
+  }
+  while (done < len) {
+    io_region_t region;
+    size_t n = len - done < XFER_CHUNK ? len - done : XFER_CHUNK;
+    ssize_t got;
+
+    if (io_ctx_region_map(ctx, &region, phys + done, n))
+      goto fail;
+    if (bounce) {
+      drop_direct_if_unaligned(fd, n);
+      got = read_full(fd, bounce, n);
+      if (got > 0)
+        memcpy((void *)region.base, bounce, (size_t)got);
+    } else {
+      got = read_full(fd, region.base, n);
+    }
+    io_region_unmap(&region);
+    if (got < 0)
+      goto fail;
+    done += (size_t)got;
+    if ((size_t)got < n)
+      break;
+  }
+  free(bounce);
+  return (int64_t)done;
+
+fail:
+  free(bounce);
+  return -1;
+}
+
+// Microseconds to nanoseconds, saturating so huge timeouts mean "forever"
+static inline uint64_t us_to_ns(uint64_t us)
+{
+  return us > UINT64_MAX / 1000 ? UINT64_MAX : us * 1000;
+}
+
+static inline uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Tell the CPU we are spinning so it does not starve the sibling hyperthread
+static inline void cpu_relax(void)
+{
+  __asm__ __volatile__("pause" ::: "memory");
+}
+
+// Single access on an already resolved target: simulated device,
+// port or mapped register
+static inline int target_read(io_ctx_t *ctx, bool port, volatile void *reg,
+      uintptr_t addr, size_t size, uint32_t *out_val)
+{
+  if (ctx->sim)
+    return io_sim_read(ctx->sim, addr, size, out_val);
+  *out_val = port ? port_read(addr, size) : reg_read(reg, size);
+  return 0;
+}
+
+static inline int target_write(io_ctx_t *ctx, bool port, volatile void *reg,
+       uintptr_t addr, size_t size, uint32_t value)
+{
+  if (ctx->sim)
+    return io_sim_write(ctx->sim, addr, size, value);
+  if (port)
+    port_write(addr, size, value);
+  else
+    reg_write(reg, size, value);
+  return 0;
+}
+
+static void sleep_ns(uint64_t ns)
+{
+  struct timespec ts = {
+    .tv_sec = ns / 1000000000ull,
+    .tv_nsec = ns % 1000000000ull,
+  };
+  clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+}
+
+// Short delays are spun, a sleep would overshoot them by far
+static void delay_ns(uint64_t ns)
+{
+  if (ns >= WAIT_SPIN_NS) {
+    sleep_ns(ns);
+    return;
+  }
+  uint64_t start = now_ns();
+  while (now_ns() - start < ns)
+    cpu_relax();
+}
+
+/*
+ * Poll until (reg & mask) == (value & mask) or timeout_us expires.
+ * The first WAIT_SPIN_NS are spent spinning with pause so fast
+ * completions are seen immediately, after that the loop sleeps with an
+ * exponentially growing interval.
+ * Returns 0 on match, 1 on timeout, -1 on error.
+ */
+static int wait_loop(io_ctx_t *ctx, bool port, volatile void *reg,
+      uintptr_t addr, size_t size, uint32_t mask, uint32_t value,
+      uint64_t timeout_us, uint32_t *last_val, uint64_t *elapsed_ns)
+{
+  uint64_t start = now_ns();
+  uint64_t timeout_ns = us_to_ns(timeout_us);
+  uint64_t deadline = timeout_ns > UINT64_MAX - start ? UINT64_MAX : start + timeout_ns;
+  uint64_t backoff = WAIT_SLEEP_MIN_NS;
+  uint64_t now;
+  uint32_t cur;
+  int ret;
+
+  ctx->stats.waits++;
+  for (;;) {
+    if (target_read(ctx, port, reg, addr, size, &cur)) {
+      ctx->stats.errors++;
+      return -1;
+    }
+    now = now_ns();
+    if ((cur & mask) == (value & mask)) {
+      ret = 0;
+      break;
+    }
+    if (now >= deadline) {
+      ret = 1;
+      break;
+    }
+    if (now - start < WAIT_SPIN_NS) {
+      cpu_relax();
+      continue;
+    }
+    sleep_ns(deadline - now < backoff ? deadline - now : backoff);
+    backoff = backoff * 2 < WAIT_SLEEP_MAX_NS ? backoff * 2 : WAIT_SLEEP_MAX_NS;
+  }
+
+  if (last_val)
+    *last_val = cur;
+  if (elapsed_ns)
+    *elapsed_ns = now - start;
+  return ret;
+}
+
+int io_ctx_wait(io_ctx_t *ctx, uintptr_t addr, size_t size, uint32_t mask,
+      uint32_t value, uint64_t timeout_us, uint64_t *elapsed_ns)
 {
-  if (iopl(3) == 0) {
-    has_port_access = true;
-  } else {
-    has_port_access = false;
+  bool port = !ctx->sim && use_port(ctx, addr);
+  volatile void *reg = NULL;
+
+  if (!valid_size(size)) {
+    fprintf(stderr, "Unsupported wait size %zu\n", size);
+    ctx->stats.errors++;
+    return -1;
   }
+  // The page is looked up once for the whole wait
+  if (!port && !ctx->sim) {
+    reg = map_addr(ctx, addr);
+    if (!reg) {
+      ctx->stats.errors++;
+      return -1;
+    }
+  }
+  return wait_loop(ctx, port, reg, addr, size, mask, value, timeout_us,
+       NULL, elapsed_ns);
+}
+
+static int batch_op(io_ctx_t *ctx, const io_op_t *op, bool port,
+      volatile void *reg, io_result_t *res)
+{
+  uint32_t val;
 
-  dev_mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-  if (dev_mem_fd < 0) {
-    return has_port_access;
+  switch (op->op) {
+  case IO_OP_READ:
+    ctx->stats.reads++;
+    if (target_read(ctx, port, reg, op->addr, op->size, &res->value))
+      return -1;
+    return 0;
+  case IO_OP_WRITE:
+    ctx->stats.writes++;
+    res->value = op->value;
+    return target_write(ctx, port, reg, op->addr, op->size, op->value);
+  case IO_OP_MODIFY:
+    ctx->stats.reads++;
+    ctx->stats.writes++;
+    if (target_read(ctx, port, reg, op->addr, op->size, &val))
+      return -1;
+    res->value = (val & ~op->mask) | (op->value & op->mask);
+    return target_write(ctx, port, reg, op->addr, op->size, res->value);
+  default:
+    return wait_loop(ctx, port, reg, op->addr, op->size, op->mask,
+         op->value, op->timeout_us, &res->value, &res->elapsed_ns);
   }
+}
+
+size_t io_batch(io_ctx_t *ctx, const io_op_t *ops, size_t count,
+     io_result_t *results)
+{
+  uintptr_t cur_page = 0;
+  volatile uint8_t *cur_map = NULL; // mapping of cur_page, reused by neighbours
+  size_t done;
+
+  for (done = 0; done < count; done++) {
+    const io_op_t *op = &ops[done];
+    io_result_t *res = &results[done];
+    volatile void *reg = NULL;
+    bool port = false;
 
+    res->elapsed_ns = 0;
+    res->value = 0;
+    res->status = 0;
+    if (op->op == IO_OP_DELAY) {
+      delay_ns(us_to_ns(op->timeout_us));
+      res->elapsed_ns = us_to_ns(op->timeout_us);
+      continue;
+    }
+    if (op->op > IO_OP_DELAY || !valid_size(op->size)) {
+      fprintf(stderr, "Unsupported batch operation %u size %u\n",
+        (unsigned)op->op, (unsigned)op->size);
+      res->status = -1;
+      ctx->stats.errors++;
+      break;
+    }
+    if (!ctx->sim) {
+      port = use_port(ctx, op->addr);
+      if (!port) {
+        uintptr_t page = align_to_page(op->addr);
+        if (!cur_map || page != cur_page) {
+          cur_map = map_addr(ctx, page);
+          cur_page = page;
+          if (!cur_map) {
+            res->status = -1;
+            ctx->stats.errors++;
+            break;
+          }
+        }
+        reg = cur_map + get_page_offset(op->addr);
+      }
+    }
+    res->status = batch_op(ctx, op, port, reg, res);
+    if (res->status) {
+      if (res->status < 0 && op->op != IO_OP_WAIT)
+        ctx->stats.errors++;
+      break;
+    }
+  }
+  return done;
+}
+
+/*
+ * Global API, kept for single-threaded callers. It works on default_ctx
+ * and is therefore not reentrant.
+ */
+
+bool io_init(void)
+{
+  ctx_release(&default_ctx);
+  return ctx_setup(&default_ctx, "/dev/mem", IO_CTX_PORT_IO);
+}
+
+void io_init_lazy(void)
+{
+  ctx_release(&default_ctx);
+  ctx_setup(&default_ctx, NULL, IO_CTX_PORT_IO | IO_CTX_LAZY);
+}
+
+bool io_init_sim(const char *config_path)
+{
+  io_sim_t *sim = io_sim_load(config_path);
+  if (!sim)
+    return false;
+  ctx_release(&default_ctx);
+  default_ctx.sim = sim;
   return true;
 }
 
 void io_cleanup(void)
 {
-  if (dev_mem_fd >= 0) {
-    close(dev_mem_fd);
-    dev_mem_fd = -1;
+  ctx_release(&default_ctx);
+}
+
+io_ctx_t *io_default_ctx(void)
+{
+  return &default_ctx;
+}
+
+int io_mem_read(uintptr_t addr, size_t size, uint64_t *out_val)
+{
+  uint32_t val;
+
+  if (!valid_size(size)) {
+    fprintf(stderr, "Unsupported read size %zu\n", size);
+    return -1;
   }
+  if (ctx_mem_read(&default_ctx, addr, size, &val))
+    return -1;
+  *out_val = val;
+  return 0;
+}
+
+int io_probe(uintptr_t addr, size_t size)
+{
+  return io_ctx_probe(&default_ctx, addr, size);
 }
 
+int io_region_map(io_region_t *region, uintptr_t phys, size_t len)
+{
+  return io_ctx_region_map(&default_ctx, region, phys, len);
+}
 
 uint8_t io_read_byte(uintptr_t addr)
 {
-  uint64_t val;
-  if (is_port_address(addr) && has_port_access)
-      return inb(addr); // Use port I/O if available and address is in port range
-  if (mem_read(addr, 1, &val) == 0)
-      return (uint8_t)val; // Use memory-mapped I/O
-   return 0;
+  uint32_t val;
+  if (io_ctx_read(&default_ctx, addr, 1, &val) == 0)
+    return (uint8_t)val;
+  return 0;
 }
 
 uint16_t io_read_word(uintptr_t addr)
 {
-  uint64_t val;
-  if (is_port_address(addr) && has_port_access)
-      return inw(addr);
-  if (mem_read(addr, 2, &val) == 0)
-      return (uint16_t)val;
+  uint32_t val;
+  if (io_ctx_read(&default_ctx, addr, 2, &val) == 0)
+    return (uint16_t)val;
   return 0;
 }
 
 uint32_t io_read_dword(uintptr_t addr)
 {
-  uint64_t val;
-  if (is_port_address(addr) && has_port_access)
-      return inl(addr);
-  if (mem_read(addr, 4, &val) == 0)
-      return (uint32_t)val;
+  uint32_t val;
+  if (io_ctx_read(&default_ctx, addr, 4, &val) == 0)
+    return val;
   return 0;
 }
+
 void io_write_byte(uintptr_t addr, uint8_t value)
 {
-  if (is_port_address(addr) && has_port_access) {
-    outb(value, addr);
-    return;
-  }
-  mem_write(addr, value, 1);
+  io_ctx_write(&default_ctx, addr, 1, value);
 }
 
 void io_write_word(uintptr_t addr, uint16_t value)
 {
-  if (is_port_address(addr) && has_port_access) {
-    outw(value, addr);
-    return;
-  }
-  mem_write(addr, value, 2);
+  io_ctx_write(&default_ctx, addr, 2, value);
 }
 
 void io_write_dword(uintptr_t addr, uint32_t value)
 {
-  if (is_port_address(addr) && has_port_access) {
-    outl(value, addr);
-    return;
-  }
-  mem_write(addr, value, 4);
+  io_ctx_write(&default_ctx, addr, 4, value);
 }
 
+int io_wait_byte(uintptr_t addr, uint8_t mask, uint8_t value,
+     uint64_t timeout_us, uint64_t *elapsed_ns)
+{
+  return io_ctx_wait(&default_ctx, addr, 1, mask, value, timeout_us, elapsed_ns);
+}
+
+int io_wait_word(uintptr_t addr, uint16_t mask, uint16_t value,
+     uint64_t timeout_us, uint64_t *elapsed_ns)
+{
+  return io_ctx_wait(&default_ctx, addr, 2, mask, value, timeout_us, elapsed_ns);
+}
+
+int io_wait_dword(uintptr_t addr, uint32_t mask, uint32_t value,
+      uint64_t timeout_us, uint64_t *elapsed_ns)
+{
+  return io_ctx_wait(&default_ctx, addr, 4, mask, value, timeout_us, elapsed_ns);
+}
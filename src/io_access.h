@@ -5,8 +5,24 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 bool io_init(void);
 
+/*
+ * Like io_init(), but port I/O and /dev/mem are only set up by the
+ * first access that needs them. Failures are reported at that point.
+ */
+void io_init_lazy(void);
+
+/*
+ * Route all accesses to a simulated device model loaded from
+ * config_path instead of the hardware (see io_sim.h for the format).
+ */
+bool io_init_sim(const char *config_path);
+
 void io_cleanup(void);
 
 uint8_t io_read_byte(uintptr_t addr);
@@ -15,7 +31,10 @@ uint16_t io_read_word(uintptr_t addr);
 
 uint32_t io_read_dword(uintptr_t addr);
 
-int mem_read(uintptr_t addr, size_t size, uint64_t *out_val);
+int io_mem_read(uintptr_t addr, size_t size, uint64_t *out_val);
+
+/* Returns 0 if addr is accessible; has no side effects on a simulated device */
+int io_probe(uintptr_t addr, size_t size);
 
 void io_write_byte(uintptr_t addr, uint8_t value);
 
@@ -23,4 +42,187 @@ void io_write_word(uintptr_t addr, uint16_t value);
 
 void io_write_dword(uintptr_t addr, uint32_t value);
 
+/*
+ * Wait until (value at addr & mask) == (value & mask).
+ * Returns 0 on match, 1 on timeout, -1 on error.
+ * elapsed_ns (may be NULL) receives the time spent waiting.
+ */
+int io_wait_byte(uintptr_t addr, uint8_t mask, uint8_t value,
+     uint64_t timeout_us, uint64_t *elapsed_ns);
+
+int io_wait_word(uintptr_t addr, uint16_t mask, uint16_t value,
+     uint64_t timeout_us, uint64_t *elapsed_ns);
+
+int io_wait_dword(uintptr_t addr, uint32_t mask, uint32_t value,
+      uint64_t timeout_us, uint64_t *elapsed_ns);
+
+/*
+ * A physical memory range kept mapped between accesses.
+ * Map once with io_region_map(), then use the inline accessors below:
+ * each one compiles down to a single volatile load or store.
+ * Offsets are relative to phys and are not range checked.
+ */
+typedef struct {
+  volatile uint8_t *base; // virtual address of phys
+  uintptr_t phys;
+  size_t len;
+  void *map;              // page aligned mapping that contains the range
+  size_t map_len;
+} io_region_t;
+
+/* Requires io_init(). Returns 0 on success, -1 on failure. */
+int io_region_map(io_region_t *region, uintptr_t phys, size_t len);
+
+void io_region_unmap(io_region_t *region);
+
+/*
+ * Per-context API. An io_ctx_t owns its /dev/mem descriptor (or
+ * simulated device), a cache of mapped pages and access statistics.
+ * Functions taking a context are reentrant: threads that each use
+ * their own context never share state and take no locks.
+ */
+typedef struct io_ctx io_ctx_t;
+
+typedef struct {
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t waits;
+  uint64_t map_hits;
+  uint64_t map_misses;
+  uint64_t errors;
+} io_stats_t;
+
+/* Use port I/O (iopl) for addresses up to 0xFFFF */
+#define IO_CTX_PORT_IO  0x1
+/* Defer iopl and opening the memory file until an access needs them */
+#define IO_CTX_LAZY     0x2
+
+/*
+ * Open a context on mem_path (NULL means /dev/mem). Any file that can
+ * be mmap()ed works, addresses are then offsets into it.
+ * Returns NULL if neither the file nor port I/O is available; with
+ * IO_CTX_LAZY nothing is opened yet and only allocation can fail.
+ */
+io_ctx_t *io_ctx_open(const char *mem_path, unsigned flags);
+
+/* Context backed by its own instance of a simulated device */
+io_ctx_t *io_ctx_open_sim(const char *config_path);
+
+void io_ctx_close(io_ctx_t *ctx);
+
+/* Context used by the global io_* functions above */
+io_ctx_t *io_default_ctx(void);
+
+void io_ctx_stats(const io_ctx_t *ctx, io_stats_t *stats);
+
+/* size is 1, 2 or 4. Both return 0 on success, -1 on failure. */
+int io_ctx_read(io_ctx_t *ctx, uintptr_t addr, size_t size, uint32_t *out_val);
+
+int io_ctx_write(io_ctx_t *ctx, uintptr_t addr, size_t size, uint32_t value);
+
+int io_ctx_probe(io_ctx_t *ctx, uintptr_t addr, size_t size);
+
+/* Same contract as io_wait_* */
+int io_ctx_wait(io_ctx_t *ctx, uintptr_t addr, size_t size, uint32_t mask,
+      uint32_t value, uint64_t timeout_us, uint64_t *elapsed_ns);
+
+int io_ctx_region_map(io_ctx_t *ctx, io_region_t *region, uintptr_t phys,
+      size_t len);
+
+/*
+ * Vectored access. io_batch() runs ops[] in order in one loop, reusing
+ * the mapping of the current page for consecutive operations on it.
+ *
+ *   IO_OP_READ    results[i].value = *addr
+ *   IO_OP_WRITE   *addr = value
+ *   IO_OP_MODIFY  *addr = (*addr & ~mask) | (value & mask)
+ *   IO_OP_WAIT    wait for (*addr & mask) == (value & mask), timeout_us
+ *   IO_OP_DELAY   sleep for timeout_us, addr and size are ignored
+ *
+ * results[i].value receives the value read or written (the last value
+ * polled for IO_OP_WAIT), status is 0, 1 on timeout or -1 on error.
+ * Execution stops at the first operation that does not return 0.
+ * Returns the number of operations that completed successfully.
+ */
+typedef enum {
+  IO_OP_READ,
+  IO_OP_WRITE,
+  IO_OP_MODIFY,
+  IO_OP_WAIT,
+  IO_OP_DELAY
+} io_op_kind_t;
+
+typedef struct {
+  uintptr_t addr;
+  uint64_t timeout_us;
+  uint32_t value;
+  uint32_t mask;
+  uint8_t op;    // io_op_kind_t
+  uint8_t size;  // 1, 2 or 4
+} io_op_t;
+
+typedef struct {
+  uint64_t elapsed_ns;
+  uint32_t value;
+  int status;
+} io_result_t;
+
+size_t io_batch(io_ctx_t *ctx, const io_op_t *ops, size_t count,
+     io_result_t *results);
+
+/*
+ * Stream physical memory to and from a file descriptor. The range is
+ * mapped in large chunks and handed straight to write()/read(), so no
+ * intermediate buffer is used unless IO_XFER_DIRECT says fd was opened
+ * with O_DIRECT, in which case an aligned bounce buffer is used.
+ *
+ * io_ctx_save() writes len bytes starting at phys to fd.
+ * io_ctx_load() copies from fd to phys until EOF or len bytes.
+ * Both return the number of bytes transferred, or -1 on error.
+ */
+#define IO_XFER_DIRECT  0x1
+
+int64_t io_ctx_save(io_ctx_t *ctx, uintptr_t phys, size_t len, int fd,
+     unsigned flags);
+
+int64_t io_ctx_load(io_ctx_t *ctx, int fd, uintptr_t phys, size_t len,
+     unsigned flags);
+
+static inline uint8_t io_region_read8(const io_region_t *region, size_t off)
+{
+  return *(volatile uint8_t *)(region->base + off);
+}
+
+static inline uint16_t io_region_read16(const io_region_t *region, size_t off)
+{
+  return *(volatile uint16_t *)(region->base + off);
+}
+
+static inline uint32_t io_region_read32(const io_region_t *region, size_t off)
+{
+  return *(volatile uint32_t *)(region->base + off);
+}
+
+static inline void io_region_write8(const io_region_t *region, size_t off,
+      uint8_t value)
+{
+  *(volatile uint8_t *)(region->base + off) = value;
+}
+
+static inline void io_region_write16(const io_region_t *region, size_t off,
+      uint16_t value)
+{
+  *(volatile uint16_t *)(region->base + off) = value;
+}
+
+static inline void io_region_write32(const io_region_t *region, size_t off,
+      uint32_t value)
+{
+  *(volatile uint32_t *)(region->base + off) = value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* IO_ACCESS_H */
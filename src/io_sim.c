@@ -0,0 +1,414 @@
+#include "io_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#define SIM_LINE_MAX   8192
+#define SIM_FIFO_MAX   256
+
+// Typical non-posted read / posted write costs seen from the CPU
+#define PCIE_READ_NS   800
+#define PCIE_WRITE_NS  150
+#define LPC_READ_NS    1500
+#define LPC_WRITE_NS   1500
+
+typedef enum {
+  SIM_RW,
+  SIM_RO,
+  SIM_RC,
+  SIM_W1C,
+  SIM_FIFO,
+  SIM_COUNTER,
+  SIM_AFTER
+} sim_kind_t;
+
+typedef struct {
+  uintptr_t addr;
+  size_t width;
+  sim_kind_t kind;
+  uint32_t value;
+  uint32_t step;        // counter increment
+  uint32_t after;       // value once `remaining` reaches zero
+  uint64_t remaining;   // accesses left before `after` takes over
+  uint32_t fifo[SIM_FIFO_MAX];
+  size_t fifo_head;
+  size_t fifo_count;
+  uint64_t read_ns;
+  uint64_t write_ns;
+  int line;             // declaration line, for diagnostics
+} sim_reg_t;
+
+struct io_sim {
+  sim_reg_t *regs;
+  size_t count;
+};
+
+static inline uint32_t width_mask(size_t width)
+{
+  return width >= 4 ? 0xFFFFFFFFu : (1u << (width * 8)) - 1;
+}
+
+// nanosleep cannot resolve sub-microsecond delays, so spin on the clock
+static void sim_delay(uint64_t ns)
+{
+  struct timespec ts;
+  uint64_t start, now;
+
+  if (!ns)
+    return;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  start = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+  } while (now - start < ns);
+}
+
+static int parse_u64(const char *str, uint64_t *out)
+{
+  char *end;
+
+  if (!str || *str == '-')
+    return -1;
+  errno = 0;
+  *out = strtoull(str, &end, 0);
+  return (end == str || *end || errno == ERANGE) ? -1 : 0;
+}
+
+// Register contents must fit the declared width
+static int parse_value(const char *str, size_t width, uint64_t *out)
+{
+  if (parse_u64(str, out))
+    return -1;
+  return *out > width_mask(width) ? -1 : 0;
+}
+
+static int parse_latency(char **tok, int ntok, uint64_t *read_ns,
+       uint64_t *write_ns)
+{
+  if (ntok < 2 || ntok > 3)
+    return -1;
+  if (!strcmp(tok[1], "pcie") || !strcmp(tok[1], "lpc") ||
+      !strcmp(tok[1], "none")) {
+    if (ntok > 2)
+      return -1;
+  }
+  if (!strcmp(tok[1], "pcie")) {
+    *read_ns = PCIE_READ_NS;
+    *write_ns = PCIE_WRITE_NS;
+  } else if (!strcmp(tok[1], "lpc")) {
+    *read_ns = LPC_READ_NS;
+    *write_ns = LPC_WRITE_NS;
+  } else if (!strcmp(tok[1], "none")) {
+    *read_ns = 0;
+    *write_ns = 0;
+  } else {
+    if (parse_u64(tok[1], read_ns))
+      return -1;
+    *write_ns = *read_ns;
+    if (ntok > 2 && parse_u64(tok[2], write_ns))
+      return -1;
+  }
+  return 0;
+}
+
+static int parse_reg(char **tok, int ntok, sim_reg_t *reg)
+{
+  uint64_t addr, width, a = 0, b = 0, c = 0;
+
+  if (ntok < 4 || parse_u64(tok[1], &addr) || parse_u64(tok[2], &width))
+    return -1;
+  if (width != 1 && width != 2 && width != 4)
+    return -1;
+  reg->addr = (uintptr_t)addr;
+  reg->width = (size_t)width;
+
+  if (!strcmp(tok[3], "fifo")) {
+    reg->kind = SIM_FIFO;
+    if (ntok - 4 > SIM_FIFO_MAX)
+      return -1;
+    for (int i = 4; i < ntok; i++) {
+      if (parse_value(tok[i], reg->width, &a))
+        return -1;
+      reg->fifo[reg->fifo_count++] = (uint32_t)a;
+    }
+    return 0;
+  }
+
+  // Statement length for each kind: "reg addr width kind" plus arguments
+  int max_tok;
+  if (!strcmp(tok[3], "rw")) {
+    reg->kind = SIM_RW;
+    max_tok = 5;
+  } else if (!strcmp(tok[3], "ro")) {
+    reg->kind = SIM_RO;
+    max_tok = 5;
+  } else if (!strcmp(tok[3], "rc")) {
+    reg->kind = SIM_RC;
+    max_tok = 5;
+  } else if (!strcmp(tok[3], "w1c")) {
+    reg->kind = SIM_W1C;
+    max_tok = 5;
+  } else if (!strcmp(tok[3], "counter")) {
+    reg->kind = SIM_COUNTER;
+    max_tok = 6;
+  } else if (!strcmp(tok[3], "after")) {
+    if (ntok < 7)
+      return -1;
+    reg->kind = SIM_AFTER;
+    max_tok = 7;
+  } else {
+    return -1;
+  }
+  if (ntok > max_tok)
+    return -1;
+
+  if (reg->kind == SIM_AFTER) {
+    // The access count is not a register value, only the two states are
+    if (parse_u64(tok[4], &a) || parse_value(tok[5], reg->width, &b) ||
+        parse_value(tok[6], reg->width, &c))
+      return -1;
+    reg->remaining = a;
+    reg->value = (uint32_t)b;
+    reg->after = (uint32_t)c;
+    return 0;
+  }
+  if (ntok > 4 && parse_value(tok[4], reg->width, &a))
+    return -1;
+  if (ntok > 5 && parse_value(tok[5], reg->width, &b))
+    return -1;
+  reg->value = (uint32_t)a;
+  if (reg->kind == SIM_COUNTER)
+    reg->step = ntok > 5 ? (uint32_t)b : 1;
+  return 0;
+}
+
+static int reg_compare(const void *a, const void *b)
+{
+  const sim_reg_t *ra = a, *rb = b;
+  return (ra->addr > rb->addr) - (ra->addr < rb->addr);
+}
+
+io_sim_t *io_sim_load(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  char line[SIM_LINE_MAX];
+  uint64_t read_ns = 0, write_ns = 0;
+  size_t capacity = 0;
+  int lineno = 0;
+
+  if (!file) {
+    perror(path);
+    return NULL;
+  }
+  io_sim_t *sim = calloc(1, sizeof(*sim));
+  if (!sim) {
+    fclose(file);
+    return NULL;
+  }
+
+  while (fgets(line, sizeof(line), file)) {
+    char *tok[SIM_FIFO_MAX + 4];
+    int ntok = 0;
+    bool overflow = false;
+
+    lineno++;
+    if (!strchr(line, '\n') && !feof(file)) {
+      fprintf(stderr, "%s:%d: line too long\n", path, lineno);
+      goto fail;
+    }
+    char *hash = strchr(line, '#');
+    if (hash)
+      *hash = '\0';
+    for (char *t = strtok(line, " \t\r\n"); t; t = strtok(NULL, " \t\r\n")) {
+      if (ntok == (int)(sizeof(tok) / sizeof(tok[0]))) {
+        overflow = true;
+        break;
+      }
+      tok[ntok++] = t;
+    }
+    if (!ntok)
+      continue;
+    if (overflow) {
+      fprintf(stderr, "%s:%d: too many values (at most %d FIFO entries)\n",
+        path, lineno, SIM_FIFO_MAX);
+      goto fail;
+    }
+
+    if (!strcmp(tok[0], "latency")) {
+      if (parse_latency(tok, ntok, &read_ns, &write_ns))
+        goto bad_line;
+      continue;
+    }
+    if (strcmp(tok[0], "reg"))
+      goto bad_line;
+
+    if (sim->count == capacity) {
+      size_t new_capacity = capacity ? capacity * 2 : 16;
+      sim_reg_t *regs = realloc(sim->regs, new_capacity * sizeof(*regs));
+      if (!regs)
+        goto fail;
+      sim->regs = regs;
+      capacity = new_capacity;
+    }
+    sim_reg_t *reg = &sim->regs[sim->count];
+    memset(reg, 0, sizeof(*reg));
+    if (parse_reg(tok, ntok, reg))
+      goto bad_line;
+    reg->read_ns = read_ns;
+    reg->write_ns = write_ns;
+    reg->line = lineno;
+    sim->count++;
+  }
+  fclose(file);
+  qsort(sim->regs, sim->count, sizeof(*sim->regs), reg_compare);
+  // Accesses resolve to the register containing them, so ranges must not overlap
+  for (size_t i = 1; i < sim->count; i++) {
+    const sim_reg_t *a = &sim->regs[i - 1], *b = &sim->regs[i];
+    if (b->addr - a->addr < a->width) {
+      const sim_reg_t *first = a->line < b->line ? a : b;
+      const sim_reg_t *second = first == a ? b : a;
+      if (a->addr == b->addr)
+        fprintf(stderr, "%s:%d: register 0x%lx already declared on line %d\n",
+          path, second->line, (unsigned long)b->addr, first->line);
+      else
+        fprintf(stderr, "%s:%d: register 0x%lx overlaps 0x%lx declared on line %d\n",
+          path, second->line, (unsigned long)second->addr,
+          (unsigned long)first->addr, first->line);
+      io_sim_free(sim);
+      return NULL;
+    }
+  }
+  return sim;
+
+bad_line:
+  fprintf(stderr, "%s:%d: invalid statement\n", path, lineno);
+fail:
+  fclose(file);
+  io_sim_free(sim);
+  return NULL;
+}
+
+void io_sim_free(io_sim_t *sim)
+{
+  if (!sim)
+    return;
+  free(sim->regs);
+  free(sim);
+}
+
+/*
+ * Register that contains addr. An access may start at any byte of a
+ * register; bytes past its end are not modelled (read as zero, writes
+ * dropped), like a device ignoring disabled byte lanes.
+ */
+static sim_reg_t *find_reg(io_sim_t *sim, uintptr_t addr)
+{
+  size_t lo = 0, hi = sim->count;
+
+  // First register above addr, the candidate is the one before it
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (sim->regs[mid].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo && addr - sim->regs[lo - 1].addr < sim->regs[lo - 1].width)
+    return &sim->regs[lo - 1];
+  fprintf(stderr, "No simulated register at 0x%lx\n", (unsigned long)addr);
+  return NULL;
+}
+
+// Byte lanes of the register touched by a size byte access at addr
+static inline uint32_t lane_mask(const sim_reg_t *reg, uintptr_t addr,
+       size_t size)
+{
+  unsigned shift = (unsigned)(addr - reg->addr) * 8;
+  return (uint32_t)((uint64_t)width_mask(size) << shift) & width_mask(reg->width);
+}
+
+int io_sim_probe(io_sim_t *sim, uintptr_t addr)
+{
+  return find_reg(sim, addr) ? 0 : -1;
+}
+
+int io_sim_read(io_sim_t *sim, uintptr_t addr, size_t size, uint32_t *out_val)
+{
+  sim_reg_t *reg = find_reg(sim, addr);
+  uint32_t val, lanes;
+
+  if (!reg)
+    return -1;
+  lanes = lane_mask(reg, addr, size);
+  sim_delay(reg->read_ns);
+  switch (reg->kind) {
+  case SIM_RC:
+    // Only the bytes that were read are cleared
+    val = reg->value;
+    reg->value &= ~lanes;
+    break;
+  case SIM_FIFO:
+    val = 0;
+    if (reg->fifo_count) {
+      val = reg->fifo[reg->fifo_head];
+      reg->fifo_head = (reg->fifo_head + 1) % SIM_FIFO_MAX;
+      reg->fifo_count--;
+    }
+    break;
+  case SIM_COUNTER:
+    val = reg->value;
+    reg->value = (reg->value + reg->step) & width_mask(reg->width);
+    break;
+  case SIM_AFTER:
+    if (reg->remaining) {
+      reg->remaining--;
+      val = reg->value;
+    } else {
+      val = reg->after;
+    }
+    break;
+  default:
+    val = reg->value;
+    break;
+  }
+  *out_val = (val & lanes) >> ((addr - reg->addr) * 8);
+  return 0;
+}
+
+int io_sim_write(io_sim_t *sim, uintptr_t addr, size_t size, uint32_t value)
+{
+  sim_reg_t *reg = find_reg(sim, addr);
+  uint32_t lanes;
+
+  if (!reg)
+    return -1;
+  lanes = lane_mask(reg, addr, size);
+  sim_delay(reg->write_ns);
+  value = (uint32_t)((uint64_t)value << ((addr - reg->addr) * 8)) & lanes;
+  switch (reg->kind) {
+  case SIM_RO:
+    break;
+  case SIM_W1C:
+    reg->value &= ~value;
+    break;
+  case SIM_FIFO:
+    if (reg->fifo_count < SIM_FIFO_MAX) {
+      reg->fifo[(reg->fifo_head + reg->fifo_count) % SIM_FIFO_MAX] = value;
+      reg->fifo_count++;
+    }
+    break;
+  case SIM_AFTER:
+    if (reg->remaining)
+      reg->remaining--;
+    break;
+  default:
+    // Byte enables: bytes outside the access keep their value
+    reg->value = (reg->value & ~lanes) | value;
+    break;
+  }
+  return 0;
+}
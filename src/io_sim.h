@@ -0,0 +1,55 @@
+#ifndef IO_SIM_H
+#define IO_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Simulated device model used instead of real port I/O and /dev/mem.
+ *
+ * The model is loaded from a text file, one statement per line,
+ * '#' starts a comment:
+ *
+ *   latency <pcie|lpc|none|read_ns [write_ns]>
+ *       Per-access delay for the registers declared after it.
+ *   reg <addr> <width> <kind> [args...]
+ *       rw <init>                  plain read/write register
+ *       ro <value>                 writes are ignored
+ *       rc <init>                  read returns the value and clears it
+ *       w1c <init>                 writing 1 to a bit clears it
+ *       fifo [v1 v2 ...]           read pops (0 when empty), write pushes
+ *       counter <start> <step>     every read returns the value, then adds step
+ *       after <n> <before> <after> reads <before> for the first n accesses
+ *
+ * Numbers accept the usual C prefixes (0x, 0). Values must fit the
+ * register width and registers must not overlap.
+ *
+ * An access may start at any byte inside a register and only touches
+ * the bytes it covers, as with byte enables: a 1-byte write to a 4-byte
+ * rw register keeps the other three bytes, an rc read clears only the
+ * bytes read. Bytes past the end of the register read as zero and are
+ * not written.
+ */
+typedef struct io_sim io_sim_t;
+
+/* Returns NULL and prints the reason on stderr on failure */
+io_sim_t *io_sim_load(const char *path);
+
+void io_sim_free(io_sim_t *sim);
+
+/* All three return -1 if no register is declared at addr */
+int io_sim_probe(io_sim_t *sim, uintptr_t addr);
+
+int io_sim_read(io_sim_t *sim, uintptr_t addr, size_t size, uint32_t *out_val);
+
+int io_sim_write(io_sim_t *sim, uintptr_t addr, size_t size, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IO_SIM_H */
@@ -13,6 +13,7 @@ implement the cursor initially.
 #include <signal.h>
 #include "io_access.h"
 #include "command_processor.h"
+#include "output.h"
 
 #define MAX_INPUT_LENGTH 1024
 #define HISTORY_BUFFER_SIZE 4096
@@ -48,6 +49,9 @@ implement the cursor initially.
 #define NEWLINE_CHAR '\n'
 #define CARRIAGE_RETURN '\r'
 
+/* Prompt, echo and banner; kept off stdout when it carries jsonl/csv/bin */
+#define TERM_OUT  out_text_stream()
+
 #define CURSOR_LEFT   "\033[D"
 #define CURSOR_RIGHT  "\033[C"
 
@@ -94,14 +98,14 @@ void handle_escape_sequence(char *buffer, int *pos, int *cursor_pos) {
                 history_current = history_current->prev;
             }
             for (int i = 0; i < *pos; i++) {
-                printf("\b \b");
+                fprintf(TERM_OUT, "\b \b");
             }
             strncpy(buffer, history_current->command, MAX_INPUT_LENGTH);
             *pos = strlen(buffer);
             *cursor_pos = *pos;
-            printf("%s", buffer);
+            fprintf(TERM_OUT, "%s", buffer);
         }
-        fflush(stdout);
+        fflush(TERM_OUT);
     }
     else if (code == KEY_DOWN_ARROW) {
         if (history_current != NULL) {
@@ -111,7 +115,7 @@ void handle_escape_sequence(char *buffer, int *pos, int *cursor_pos) {
                 history_current = NULL;
             }
             for (int i = 0; i < *pos; i++) {
-                printf("\b \b");
+                fprintf(TERM_OUT, "\b \b");
             }
             if (history_current != NULL) {
                 strncpy(buffer, history_current->command, MAX_INPUT_LENGTH);
@@ -122,37 +126,37 @@ void handle_escape_sequence(char *buffer, int *pos, int *cursor_pos) {
             }
             *pos = strlen(buffer);
             *cursor_pos = *pos;
-            printf("%s", buffer);
+            fprintf(TERM_OUT, "%s", buffer);
         }
-        fflush(stdout);
+        fflush(TERM_OUT);
     }
     else if (code == KEY_LEFT_ARROW) {
         if (*cursor_pos > 0) {
             (*cursor_pos)--;
-            printf(CURSOR_LEFT);
-            fflush(stdout);
+            fprintf(TERM_OUT, CURSOR_LEFT);
+            fflush(TERM_OUT);
         }
     }
     else if (code == KEY_RIGHT_ARROW) {
         if (*cursor_pos < *pos) {
             (*cursor_pos)++;
-            printf(CURSOR_RIGHT);
-            fflush(stdout);
+            fprintf(TERM_OUT, CURSOR_RIGHT);
+            fflush(TERM_OUT);
         }
     }
     else if (code == KEY_HOME_SHORT) {
         while (*cursor_pos > 0) {
             (*cursor_pos)--;
-            printf(CURSOR_LEFT);
+            fprintf(TERM_OUT, CURSOR_LEFT);
         }
-        fflush(stdout);
+        fflush(TERM_OUT);
     }
     else if (code == KEY_END_SHORT) {
         while (*cursor_pos < *pos) {
             (*cursor_pos)++;
-            printf(CURSOR_RIGHT);
+            fprintf(TERM_OUT, CURSOR_RIGHT);
         }
-        fflush(stdout);
+        fflush(TERM_OUT);
     }
     /* Extended escape sequences (Home/End/Delete) */
     else if (code == KEY_HOME_LONG || code == KEY_END_LONG || code == KEY_DELETE_LONG) {
@@ -161,16 +165,16 @@ void handle_escape_sequence(char *buffer, int *pos, int *cursor_pos) {
             if (code == KEY_HOME_LONG) {
                 while (*cursor_pos > 0) {
                     (*cursor_pos)--;
-                    printf(CURSOR_LEFT);
+                    fprintf(TERM_OUT, CURSOR_LEFT);
                 }
-                fflush(stdout);
+                fflush(TERM_OUT);
             }
             else if (code == KEY_END_LONG) {
                 while (*cursor_pos < *pos) {
                     (*cursor_pos)++;
-                    printf(CURSOR_RIGHT);
+                    fprintf(TERM_OUT, CURSOR_RIGHT);
                 }
-                fflush(stdout);
+                fflush(TERM_OUT);
             }
             else if (code == KEY_DELETE_LONG) {
                 if (*cursor_pos < *pos) {
@@ -178,15 +182,15 @@ void handle_escape_sequence(char *buffer, int *pos, int *cursor_pos) {
                     memmove(&buffer[*cursor_pos], &buffer[*cursor_pos + 1],
                             old_pos - *cursor_pos);
                     *pos = old_pos - 1;
-                    printf("\r");
-                    printf("io> ");
-                    printf("%s", buffer);
-                    printf(" ");
+                    fprintf(TERM_OUT, "\r");
+                    fprintf(TERM_OUT, "io> ");
+                    fprintf(TERM_OUT, "%s", buffer);
+                    fprintf(TERM_OUT, " ");
                     int move_back = (*pos - *cursor_pos) + 1;
                     for (int i = 0; i < move_back; i++) {
-                        printf("\b");
+                        fprintf(TERM_OUT, "\b");
                     }
-                    fflush(stdout);
+                    fflush(TERM_OUT);
                 }
             }
         }
@@ -259,9 +263,9 @@ static void cleanup_terminal(void) {
 static void sigint_handler(int sig) {
     cleanup_terminal();
     if (sig == SIGINT) {
-        printf("\nReceived interrupt signal\n");
+        fprintf(TERM_OUT, "\nReceived interrupt signal\n");
     } else if (sig == SIGTERM) {
-        printf("\nReceived termination signal\n");
+        fprintf(TERM_OUT, "\nReceived termination signal\n");
     }
     exit(1);
 }
@@ -301,16 +305,16 @@ static char* read_line(void) {
     }
     struct termios original_termios;
     set_terminal_mode(&original_termios);
-    printf("\rio> ");
+    fprintf(TERM_OUT, "\rio> ");
     if (pos > 0) {
-        printf("%s", buffer);
+        fprintf(TERM_OUT, "%s", buffer);
     }
-    fflush(stdout);
+    fflush(TERM_OUT);
     while (1) {
         c = getchar();
         if (c == NEWLINE_CHAR || c == CARRIAGE_RETURN) {
             buffer[pos] = NULL_TERMINATOR;
-            printf("\r\n");
+            fprintf(TERM_OUT, "\r\n");
             if (pos > 0) {
                 add_to_history(buffer);
             }
@@ -325,15 +329,15 @@ static char* read_line(void) {
                 memmove(&buffer[cursor_pos - 1], &buffer[cursor_pos], pos - cursor_pos + 1);
                 pos--;
                 cursor_pos--;
-                printf("\b");
+                fprintf(TERM_OUT, "\b");
                 for (int i = cursor_pos; i < pos; i++) {
-                    printf("%c", buffer[i]);
+                    fprintf(TERM_OUT, "%c", buffer[i]);
                 }
-                printf(" ");
+                fprintf(TERM_OUT, " ");
                 for (int i = 0; i <= pos - cursor_pos; i++) {
-                    printf("\b");
+                    fprintf(TERM_OUT, "\b");
                 }
-                fflush(stdout);
+                fflush(TERM_OUT);
             }
         }
         else if (c == KEY_ESCAPE) {
@@ -348,30 +352,30 @@ static char* read_line(void) {
             cursor_pos++;
             buffer[pos] = NULL_TERMINATOR;
             if (cursor_pos == pos) {
-                printf("%c", c);
+                fprintf(TERM_OUT, "%c", c);
             }
             else {
                 for (int i = cursor_pos - 1; i < pos; i++) {
-                    printf("%c", buffer[i]);
+                    fprintf(TERM_OUT, "%c", buffer[i]);
                 }
                 for (int i = 0; i < pos - cursor_pos; i++) {
-                    printf("\b");
+                    fprintf(TERM_OUT, "\b");
                 }
             }
-            fflush(stdout);
+            fflush(TERM_OUT);
             if (has_unfinished_input) {
                 has_unfinished_input = false;
                 unfinished_input[0] = NULL_TERMINATOR;
             }
         }
         else if (c == KEY_CTRL_C) {
-            printf("\r\n");
+            fprintf(TERM_OUT, "\r\n");
             reset_terminal_mode(&original_termios);
             return NULL;
         }
         else if (c == KEY_CTRL_D) {
             if (pos == 0) {
-                printf("\r\n");
+                fprintf(TERM_OUT, "\r\n");
                 reset_terminal_mode(&original_termios);
                 return NULL;
             }
@@ -379,23 +383,124 @@ static char* read_line(void) {
     }
 }
 
-int main(void) {
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--output=text|jsonl|csv|bin] [--sim=CONFIG] [--eager] [command args...]...\n", prog);
+}
+
+/*
+ * One-shot mode: argv holds one or more commands, e.g.
+ * "io_tool iord 0x61 iowb 0x80 1". Each command takes its required
+ * arguments, then optional ones up to the next command name, so
+ * "iosave 0 16 end" saves to a file named "end".
+ * Returns EXIT_FAILURE if any command failed or a wait timed out.
+ */
+static int run_commands(int argc, char **argv) {
+    char line[MAX_INPUT_LENGTH];
+    int i = 0;
+
+    while (i < argc) {
+        int max_args, min_args = command_args(argv[i], &max_args);
+        int end = i + 1;
+        size_t len = 0;
+
+        if (min_args < 0) {
+            /* Unknown word: pass it on with its arguments to report it */
+            while (end < argc && command_args(argv[end], NULL) < 0)
+                end++;
+        } else {
+            end += min_args;
+            while (end < argc && end - i - 1 < max_args &&
+                   command_args(argv[end], NULL) < 0)
+                end++;
+            if (end > argc)
+                end = argc;
+        }
+        for (; i < end; i++) {
+            int n = snprintf(line + len, sizeof(line) - len, "%s%s",
+                             len ? " " : "", argv[i]);
+            if (n < 0 || (size_t)n >= sizeof(line) - len) {
+                fprintf(stderr, "Command too long at: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            len += n;
+        }
+        if (process_command(line))
+            break;
+    }
+    if (batch_pending()) {
+        fprintf(stderr, "Batch not closed with 'end', operations discarded\n");
+        process_command("cancel");
+        return EXIT_FAILURE;
+    }
+    return command_failed() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    const char *sim_config = NULL;
+    bool eager = false;
+    int first_cmd;
+
+    for (first_cmd = 1; first_cmd < argc && !strncmp(argv[first_cmd], "--", 2); first_cmd++) {
+        const char *opt = argv[first_cmd];
+        if (!strcmp(opt, "--")) {
+            first_cmd++;
+            break;
+        }
+        if (!strncmp(opt, "--output=", 9) && !out_set_mode(opt + 9))
+            continue;
+        if (!strncmp(opt, "--sim=", 6) && opt[6]) {
+            sim_config = opt + 6;
+            continue;
+        }
+        if (!strcmp(opt, "--eager")) {
+            eager = true;
+            continue;
+        }
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /*
+     * No terminal, banner or eager backend setup for one-shot commands;
+     * --eager keeps the old up-front io_init() for comparison
+     */
+    if (first_cmd < argc) {
+        if (sim_config) {
+            if (!io_init_sim(sim_config))
+                return EXIT_FAILURE;
+        } else if (!eager) {
+            io_init_lazy();
+        } else if (!io_init()) {
+            fprintf(stderr, "Initialization failed. Some features may not work properly.\n");
+        }
+        int ret = run_commands(argc - first_cmd, argv + first_cmd);
+        out_flush();
+        io_cleanup();
+        return ret;
+    }
+
 	/* Save original terminal state */
 	tcgetattr(STDIN_FILENO, &original_termios_global); //turned on the work with the terminal
     termios_initialized = 1;
 	/* Register cleanup handlers */
     atexit(cleanup_terminal);
     atexit(free_history);
+    atexit(out_flush);
 	signal(SIGINT, sigint_handler);
     signal(SIGTERM, sigint_handler);
-    printf("IO Access Tool - Low-level hardware register access\n");
-    if (geteuid() != 0) {
+    fprintf(TERM_OUT, "IO Access Tool - Low-level hardware register access\n");
+    if (sim_config) {
+        if (!io_init_sim(sim_config))
+            return EXIT_FAILURE;
+        fprintf(TERM_OUT, "Using simulated device from %s\r\n", sim_config);
+    }
+    else if (geteuid() != 0) {
         fprintf(stderr, "Warning: Running without root privileges. Many operations will fail.\r\n");
     }
     else if (!io_init()) {
         fprintf(stderr, "Initialization failed. Some features may not work properly.\r\n");
     }
-    printf("Type 'help' for available commands.\r\n");
+    fprintf(TERM_OUT, "Type 'help' for available commands.\r\n");
     
     char* line;
     int should_exit = 0;
@@ -407,11 +512,12 @@ int main(void) {
             break;
         }
         should_exit = process_command(line);
+        out_flush();
     }
     
     io_cleanup();
     free_history();
-    printf("Exiting IO Access Tool. Goodbye!\r\n");
+    fprintf(TERM_OUT, "Exiting IO Access Tool. Goodbye!\r\n");
     
     return 0;
 }
@@ -0,0 +1,206 @@
+#include "output.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define OUT_BUFFER_SIZE  (256 * 1024) // Flushed when full or on out_flush()
+#define OUT_RECORD_MAX   256          // Upper bound of one formatted record
+
+static char out_buffer[OUT_BUFFER_SIZE];
+static size_t out_used = 0;
+static out_mode_t out_mode = OUT_TEXT;
+static int csv_header_done = 0;
+static const char csv_header[] = "op,addr,width,value,status,elapsed_ns\n";
+
+static const char *op_name(out_op_t op)
+{
+    switch (op) {
+    case OUT_OP_READ:
+        return "read";
+    case OUT_OP_WRITE:
+        return "write";
+    case OUT_OP_SAVE:
+        return "save";
+    case OUT_OP_LOAD:
+        return "load";
+    default:
+        return "wait";
+    }
+}
+
+static const char *width_name(unsigned width)
+{
+    switch (width) {
+    case 1:
+        return "byte";
+    case 2:
+        return "word";
+    default:
+        return "dword";
+    }
+}
+
+int out_set_mode(const char *name)
+{
+    if (!strcmp(name, "text"))
+        out_mode = OUT_TEXT;
+    else if (!strcmp(name, "jsonl"))
+        out_mode = OUT_JSONL;
+    else if (!strcmp(name, "csv"))
+        out_mode = OUT_CSV;
+    else if (!strcmp(name, "bin"))
+        out_mode = OUT_BIN;
+    else
+        return -1;
+    return 0;
+}
+
+out_mode_t out_get_mode(void)
+{
+    return out_mode;
+}
+
+void out_flush(void)
+{
+    size_t done = 0;
+
+    /* Anything already sitting in stdio (help, prompts) goes first */
+    fflush(stdout);
+    while (done < out_used) {
+        ssize_t n = write(STDOUT_FILENO, out_buffer + done, out_used - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        done += (size_t)n;
+    }
+    out_used = 0;
+}
+
+static char *out_reserve(size_t len)
+{
+    if (out_used + len > OUT_BUFFER_SIZE)
+        out_flush();
+    return out_buffer + out_used;
+}
+
+// Formats one record into buf, returns its length
+static size_t format_record(char *buf, out_op_t op, uintptr_t addr,
+        unsigned width, uint64_t value, int status, uint64_t elapsed_ns)
+{
+    unsigned digits = width * 2;
+    int n = 0;
+
+    if (out_mode == OUT_BIN) {
+        out_record_t rec = {
+            .addr = addr,
+            .value = value,
+            .elapsed_ns = elapsed_ns,
+            .op = (uint8_t)op,
+            .width = (uint8_t)width,
+            .status = (uint8_t)status,
+        };
+        memcpy(buf, &rec, sizeof(rec));
+        return sizeof(rec);
+    }
+
+    switch (out_mode) {
+    case OUT_JSONL:
+        n = snprintf(buf, OUT_RECORD_MAX,
+                "{\"op\":\"%s\",\"addr\":%lu,\"width\":%u,\"value\":%llu,"
+                "\"status\":%d,\"elapsed_ns\":%llu}\n",
+                op_name(op), (unsigned long)addr, width,
+                (unsigned long long)value, status,
+                (unsigned long long)elapsed_ns);
+        break;
+    case OUT_CSV:
+        n = snprintf(buf, OUT_RECORD_MAX, "%s,%lu,%u,%llu,%d,%llu\n",
+                op_name(op), (unsigned long)addr, width,
+                (unsigned long long)value, status,
+                (unsigned long long)elapsed_ns);
+        break;
+    default:
+        if (op == OUT_OP_READ) {
+            n = snprintf(buf, OUT_RECORD_MAX, "address 0x%lX: 0x%0*llX\n",
+                    (unsigned long)addr, digits, (unsigned long long)value);
+        } else if (op == OUT_OP_WRITE) {
+            n = snprintf(buf, OUT_RECORD_MAX, "Write %s 0x%0*llX to address 0x%lX\n",
+                    width_name(width), digits, (unsigned long long)value,
+                    (unsigned long)addr);
+        } else if (op == OUT_OP_WAIT) {
+            n = snprintf(buf, OUT_RECORD_MAX, "address 0x%lX: %s after %llu.%03llu us\n",
+                    (unsigned long)addr,
+                    status == OUT_STATUS_OK ? "matched" : "timeout",
+                    (unsigned long long)(elapsed_ns / 1000),
+                    (unsigned long long)(elapsed_ns % 1000));
+        } else {
+            double sec = elapsed_ns / 1e9;
+            n = snprintf(buf, OUT_RECORD_MAX, "%s %llu bytes %s 0x%lX in %.3f s (%.1f MiB/s)%s\n",
+                    op == OUT_OP_SAVE ? "Saved" : "Loaded",
+                    (unsigned long long)value, op == OUT_OP_SAVE ? "from" : "to",
+                    (unsigned long)addr, sec,
+                    sec > 0 ? value / sec / (1024 * 1024) : 0.0,
+                    status == OUT_STATUS_OK ? "" : ", failed");
+        }
+        break;
+    }
+    if (n <= 0)
+        return 0;
+    return (size_t)n < OUT_RECORD_MAX ? (size_t)n : OUT_RECORD_MAX - 1;
+}
+
+static void out_record(out_op_t op, uintptr_t addr, unsigned width,
+        uint64_t value, int status, uint64_t elapsed_ns)
+{
+    if (out_mode == OUT_CSV && !csv_header_done) {
+        char *p = out_reserve(sizeof(csv_header) - 1);
+        memcpy(p, csv_header, sizeof(csv_header) - 1);
+        out_used += sizeof(csv_header) - 1;
+        csv_header_done = 1;
+    }
+    out_used += format_record(out_reserve(OUT_RECORD_MAX), op, addr, width,
+            value, status, elapsed_ns);
+}
+
+void out_read(uintptr_t addr, unsigned width, uint32_t value)
+{
+    out_record(OUT_OP_READ, addr, width, value, OUT_STATUS_OK, 0);
+}
+
+void out_write(uintptr_t addr, unsigned width, uint32_t value)
+{
+    out_record(OUT_OP_WRITE, addr, width, value, OUT_STATUS_OK, 0);
+}
+
+void out_wait(uintptr_t addr, unsigned width, int status, uint64_t elapsed_ns)
+{
+    out_record(OUT_OP_WAIT, addr, width, 0, status, elapsed_ns);
+}
+
+void out_transfer(out_op_t op, uintptr_t addr, uint64_t bytes, int status,
+        uint64_t elapsed_ns, int to_stderr)
+{
+    char buf[OUT_RECORD_MAX];
+    size_t len;
+
+    if (!to_stderr) {
+        out_record(op, addr, 0, bytes, status, elapsed_ns);
+        return;
+    }
+    len = format_record(buf, op, addr, 0, bytes, status, elapsed_ns);
+    if (write(STDERR_FILENO, buf, len) < 0)
+        perror("write");
+}
+
+void out_error(out_op_t op, uintptr_t addr, unsigned width)
+{
+    if (out_mode != OUT_TEXT)
+        out_record(op, addr, width, 0, OUT_STATUS_ERROR, 0);
+}
+
+FILE *out_text_stream(void)
+{
+    return out_mode == OUT_TEXT ? stdout : stderr;
+}
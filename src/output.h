@@ -0,0 +1,83 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Result output for all commands.
+ * Records are formatted into one large buffer and written to stdout
+ * with write() when the buffer fills up or out_flush() is called.
+ *
+ * text  - human readable lines (default)
+ * jsonl - one JSON object per line
+ * csv   - "op,addr,width,value,status,elapsed_ns" with a header line
+ * bin   - fixed size out_record_t records in host byte order
+ *
+ * For save/load records width is 0 and value is the number of bytes
+ * transferred.
+ */
+typedef enum {
+    OUT_TEXT,
+    OUT_JSONL,
+    OUT_CSV,
+    OUT_BIN
+} out_mode_t;
+
+typedef enum {
+    OUT_OP_READ  = 1,
+    OUT_OP_WRITE = 2,
+    OUT_OP_WAIT  = 3,
+    OUT_OP_SAVE  = 4,
+    OUT_OP_LOAD  = 5
+} out_op_t;
+
+/* Record status, also used in the status field of bin records */
+#define OUT_STATUS_OK       0
+#define OUT_STATUS_TIMEOUT  1
+#define OUT_STATUS_ERROR    2
+
+typedef struct {
+    uint64_t addr;
+    uint64_t value;
+    uint64_t elapsed_ns;
+    uint8_t  op;
+    uint8_t  width;
+    uint8_t  status;
+    uint8_t  reserved[5];
+} out_record_t;
+
+/* Parse "text", "jsonl", "csv" or "bin". Returns -1 on unknown mode. */
+int out_set_mode(const char *name);
+
+out_mode_t out_get_mode(void);
+
+void out_read(uintptr_t addr, unsigned width, uint32_t value);
+
+void out_write(uintptr_t addr, unsigned width, uint32_t value);
+
+void out_wait(uintptr_t addr, unsigned width, int status, uint64_t elapsed_ns);
+
+/*
+ * Result of iosave/ioload. With to_stderr the record bypasses the
+ * buffer and goes to stderr, for transfers that streamed data to stdout.
+ */
+void out_transfer(out_op_t op, uintptr_t addr, uint64_t bytes, int status,
+        uint64_t elapsed_ns, int to_stderr);
+
+/*
+ * Failed access. Text mode prints nothing, the reason is already on
+ * stderr; the other modes emit a record with OUT_STATUS_ERROR.
+ */
+void out_error(out_op_t op, uintptr_t addr, unsigned width);
+
+/*
+ * Stream for human oriented text (banner, prompt, help): stdout in
+ * text mode, stderr otherwise so machine readable output stays clean.
+ */
+FILE *out_text_stream(void);
+
+void out_flush(void);
+
+#endif /* OUTPUT_H */
@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Startup cost of one-shot io_tool invocations: runs the same command
+# N times with the default lazy backend setup and with --eager (the
+# old path that sets up port I/O and /dev/mem before the first command).
+# Run it as root on the target: without privileges the eager setup fails
+# at once and both modes cost about the same.
+#
+# Usage: bench_startup.sh [io_tool] [runs] [command args...]
+#   io_tool  binary to time (default ./io_tool)
+#   runs     invocations per mode (default 500)
+#   command  one-shot command line (default "flush", a no-op that
+#            leaves only startup and teardown)
+
+tool=${1:-./io_tool}
+runs=${2:-500}
+[ $# -gt 2 ] && shift 2 || set -- flush
+
+if [ ! -x "$tool" ]; then
+    echo "bench_startup: $tool is not executable" >&2
+    exit 1
+fi
+
+now_ns() {
+    date +%s%N
+}
+
+# Prints the average wall time per invocation in microseconds
+time_runs() {
+    start=$(now_ns)
+    i=0
+    while [ $i -lt "$runs" ]; do
+        "$tool" "$@" >/dev/null 2>&1
+        i=$((i + 1))
+    done
+    end=$(now_ns)
+    echo $(((end - start) / runs / 1000))
+}
+
+# Warm the page cache so the first mode is not penalized
+"$tool" "$@" >/dev/null 2>&1
+
+lazy=$(time_runs "$@")
+eager=$(time_runs --eager "$@")
+
+echo "io_tool $*: $runs runs per mode"
+printf "%-6s %8s us/run\n" lazy "$lazy" eager "$eager"
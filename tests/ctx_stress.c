@@ -0,0 +1,207 @@
+/*
+ * Multithreaded stress and throughput test for the io_ctx_* API.
+ *
+ * Every thread opens its own context on the same temporary file, the
+ * file-backed stand-in for /dev/mem, and mixes single accesses and
+ * io_batch() on a private range and on a page shared by all threads.
+ * Values read back and the per-context statistics are checked, and
+ * access throughput is reported for 1..N threads.
+ *
+ * Usage: ctx_stress [max_threads]
+ */
+#include "io_access.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PAGE_SIZE      4096
+#define OWN_PAGES      8                       // private pages per thread
+#define OWN_WORDS      (OWN_PAGES * PAGE_SIZE / 4)
+#define SHARED_BASE    0                       // page written by all threads
+#define CACHE_PAGES    16                      // MAP_CACHE_SIZE of io_access.c
+// Private pages use cache slots 1..OWN_PAGES, the shared page slot 0, so
+// the test measures access cost rather than direct-mapped slot conflicts
+#define OWN_BASE(t)    (((uintptr_t)(t) + 1) * CACHE_PAGES * PAGE_SIZE + PAGE_SIZE)
+#define SINGLE_OPS     200000                  // iterations of the single access loop
+#define BATCHES        2000
+#define BATCH_WRITES   32
+#define DEFAULT_THREADS 8
+
+typedef struct {
+  const char *path;
+  int id;
+  int failed;
+  uint64_t ops;
+} worker_t;
+
+static inline uint32_t pattern(int id, uint32_t i)
+{
+  return ((uint32_t)id << 24) ^ (i * 2654435761u);
+}
+
+static void fail(worker_t *w, const char *what, uintptr_t addr,
+     uint32_t got, uint32_t want)
+{
+  if (!w->failed)
+    fprintf(stderr, "thread %d: %s at 0x%lx: got 0x%08x, want 0x%08x\n",
+      w->id, what, (unsigned long)addr, got, want);
+  w->failed = 1;
+}
+
+static void *worker(void *arg)
+{
+  worker_t *w = arg;
+  io_ctx_t *ctx = io_ctx_open(w->path, 0);
+  uintptr_t shared = SHARED_BASE + (uintptr_t)w->id * 4;
+  io_op_t ops[2 * BATCH_WRITES];
+  io_result_t res[2 * BATCH_WRITES];
+  uint32_t val;
+
+  if (!ctx) {
+    fprintf(stderr, "thread %d: cannot open %s\n", w->id, w->path);
+    w->failed = 1;
+    return NULL;
+  }
+
+  for (uint32_t i = 0; i < SINGLE_OPS && !w->failed; i++) {
+    uintptr_t addr = OWN_BASE(w->id) + (uintptr_t)(i % OWN_WORDS) * 4;
+    uint32_t want = pattern(w->id, i);
+
+    if (io_ctx_write(ctx, addr, 4, want) || io_ctx_read(ctx, addr, 4, &val))
+      fail(w, "access failed", addr, 0, want);
+    else if (val != want)
+      fail(w, "private mismatch", addr, val, want);
+
+    if (io_ctx_write(ctx, shared, 4, i) || io_ctx_read(ctx, shared, 4, &val))
+      fail(w, "access failed", shared, 0, i);
+    else if (val != i)
+      fail(w, "shared mismatch", shared, val, i);
+  }
+
+  for (uint32_t b = 0; b < BATCHES && !w->failed; b++) {
+    for (int k = 0; k < BATCH_WRITES; k++) {
+      // Spread over all private pages so batches cross page boundaries
+      uintptr_t addr = OWN_BASE(w->id) +
+        (uintptr_t)((b * BATCH_WRITES + k) * 67 % OWN_WORDS) * 4;
+      ops[k] = (io_op_t){ .op = IO_OP_WRITE, .size = 4, .addr = addr,
+                          .value = pattern(w->id, b * BATCH_WRITES + k) };
+      ops[BATCH_WRITES + k] = (io_op_t){ .op = IO_OP_READ, .size = 4, .addr = addr };
+    }
+    size_t done = io_batch(ctx, ops, 2 * BATCH_WRITES, res);
+    if (done != 2 * BATCH_WRITES) {
+      fail(w, "batch stopped", ops[done].addr, (uint32_t)done, 2 * BATCH_WRITES);
+      break;
+    }
+    for (int k = 0; k < BATCH_WRITES; k++) {
+      if (res[BATCH_WRITES + k].value != ops[k].value)
+        fail(w, "batch mismatch", ops[k].addr, res[BATCH_WRITES + k].value, ops[k].value);
+    }
+  }
+
+  io_stats_t st;
+  io_ctx_stats(ctx, &st);
+  uint64_t expect = 2ull * SINGLE_OPS + (uint64_t)BATCHES * BATCH_WRITES;
+  if (!w->failed && (st.reads != expect || st.writes != expect || st.errors ||
+      st.waits || !st.map_misses || !st.map_hits)) {
+    fprintf(stderr, "thread %d: bad stats: reads %llu writes %llu (want %llu) "
+      "errors %llu waits %llu hits %llu misses %llu\n", w->id,
+      (unsigned long long)st.reads, (unsigned long long)st.writes,
+      (unsigned long long)expect, (unsigned long long)st.errors,
+      (unsigned long long)st.waits, (unsigned long long)st.map_hits,
+      (unsigned long long)st.map_misses);
+    w->failed = 1;
+  }
+  w->ops = st.reads + st.writes;
+  io_ctx_close(ctx);
+  return NULL;
+}
+
+static double now_sec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Each thread's last single-loop write must still be in its shared slot
+static int check_shared(const char *path, int nthreads)
+{
+  io_ctx_t *ctx = io_ctx_open(path, 0);
+  int ret = 0;
+
+  if (!ctx)
+    return -1;
+  for (int t = 0; t < nthreads; t++) {
+    uint32_t val;
+    if (io_ctx_read(ctx, SHARED_BASE + (uintptr_t)t * 4, 4, &val) ||
+        val != SINGLE_OPS - 1) {
+      fprintf(stderr, "shared slot %d lost its last write\n", t);
+      ret = -1;
+    }
+  }
+  io_ctx_close(ctx);
+  return ret;
+}
+
+static int run(const char *path, int nthreads, double *ops_per_sec)
+{
+  pthread_t tid[nthreads];
+  worker_t w[nthreads];
+  uint64_t ops = 0;
+  int ret = 0;
+
+  double start = now_sec();
+  for (int t = 0; t < nthreads; t++) {
+    w[t] = (worker_t){ .path = path, .id = t };
+    if (pthread_create(&tid[t], NULL, worker, &w[t])) {
+      perror("pthread_create");
+      return -1;
+    }
+  }
+  for (int t = 0; t < nthreads; t++) {
+    pthread_join(tid[t], NULL);
+    ops += w[t].ops;
+    ret |= w[t].failed;
+  }
+  *ops_per_sec = ops / (now_sec() - start);
+  if (!ret)
+    ret = check_shared(path, nthreads);
+  return ret ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+  int max_threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+  char path[] = "/tmp/ctx_stress.XXXXXX";
+  double base = 0;
+  int ret = 0;
+
+  if (max_threads < 1 || max_threads > 255) {
+    fprintf(stderr, "Usage: %s [max_threads 1..255]\n", argv[0]);
+    return 2;
+  }
+  int fd = mkstemp(path);
+  if (fd < 0 || ftruncate(fd, OWN_BASE(max_threads))) {
+    perror("temporary file");
+    return 1;
+  }
+  close(fd);
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  printf("threads      ops/s  speedup  (%ld CPUs online)\n", cpus);
+  for (int n = 1; n <= max_threads; n *= 2) {
+    double rate;
+    if (run(path, n, &rate)) {
+      ret = 1;
+      break;
+    }
+    if (n == 1)
+      base = rate;
+    printf("%7d %10.0f %8.2f\n", n, rate, rate / base);
+  }
+  unlink(path);
+  return ret;
+}
@@ -0,0 +1,259 @@
+/*
+ * Checks of the simulated device model behind io_ctx_open_sim().
+ *
+ * Every register kind is read and written through a context, including
+ * accesses narrower than the register and inside it, the latency of a
+ * "pcie" register is measured through io_batch(), and configurations
+ * that must be rejected at load time are loaded one by one.
+ *
+ * Usage: sim_model
+ */
+#include "io_access.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LATENCY_READS  16
+#define PCIE_READ_NS   800    // io_sim.c preset for "latency pcie"
+#define PCIE_WRITE_NS  150
+
+static const char model[] =
+  "# one register of each kind\n"
+  "reg 0x10 4 rw 0x12345678\n"
+  "reg 0x14 2 ro 0xBEEF\n"
+  "reg 0x18 4 rc 0xAABBCCDD\n"
+  "reg 0x1C 1 w1c 0xFF\n"
+  "reg 0x20 1 fifo 1 2 3\n"
+  "reg 0x24 2 counter 5 2\n"
+  "reg 0x28 1 after 3 0 1\n"
+  "latency pcie\n"
+  "reg 0x100 4 rw 0\n";
+
+static int failures;
+
+static void check(const char *what, uint32_t got, uint32_t want)
+{
+  if (got != want) {
+    fprintf(stderr, "FAIL %s: got 0x%x, want 0x%x\n", what, got, want);
+    failures++;
+  }
+}
+
+// Writes text to a new temporary file and returns its path in path
+static int write_config(char *path, const char *text)
+{
+  size_t len = strlen(text);
+  int fd = mkstemp(path);
+
+  if (fd < 0) {
+    perror("mkstemp");
+    return -1;
+  }
+  if (write(fd, text, len) != (ssize_t)len) {
+    perror(path);
+    close(fd);
+    return -1;
+  }
+  close(fd);
+  return 0;
+}
+
+static io_ctx_t *open_model(const char *text)
+{
+  char path[] = "/tmp/sim_model.XXXXXX";
+  io_ctx_t *ctx;
+
+  if (write_config(path, text))
+    return NULL;
+  ctx = io_ctx_open_sim(path);
+  unlink(path);
+  return ctx;
+}
+
+static uint32_t rd(io_ctx_t *ctx, uintptr_t addr, size_t size)
+{
+  uint32_t val = 0xDEADBEEF;
+
+  if (io_ctx_read(ctx, addr, size, &val)) {
+    fprintf(stderr, "FAIL read of %zu bytes at 0x%lx\n", size, (unsigned long)addr);
+    failures++;
+  }
+  return val;
+}
+
+static void wr(io_ctx_t *ctx, uintptr_t addr, size_t size, uint32_t value)
+{
+  if (io_ctx_write(ctx, addr, size, value)) {
+    fprintf(stderr, "FAIL write of %zu bytes at 0x%lx\n", size, (unsigned long)addr);
+    failures++;
+  }
+}
+
+static void test_kinds(io_ctx_t *ctx)
+{
+  uint32_t val;
+
+  // rw: narrower writes only replace the bytes they cover
+  wr(ctx, 0x10, 1, 0xFF);
+  check("rw after byte write", rd(ctx, 0x10, 4), 0x123456FF);
+  wr(ctx, 0x12, 2, 0xA5A5);
+  check("rw after word write at +2", rd(ctx, 0x10, 4), 0xA5A556FF);
+  check("rw byte read at +1", rd(ctx, 0x11, 1), 0x56);
+  check("rw word read at +2", rd(ctx, 0x12, 2), 0xA5A5);
+  check("rw dword read at +3", rd(ctx, 0x13, 4), 0xA5);
+  wr(ctx, 0x10, 4, 0x01020304);
+  check("rw after dword write", rd(ctx, 0x10, 4), 0x01020304);
+
+  // ro: writes are ignored
+  wr(ctx, 0x14, 2, 0x1234);
+  check("ro after write", rd(ctx, 0x14, 2), 0xBEEF);
+  check("ro high byte", rd(ctx, 0x15, 1), 0xBE);
+
+  // rc: a read clears only the bytes it returned
+  check("rc low byte", rd(ctx, 0x18, 1), 0xDD);
+  check("rc after byte read", rd(ctx, 0x18, 4), 0xAABBCC00);
+  check("rc after dword read", rd(ctx, 0x18, 4), 0);
+  wr(ctx, 0x19, 1, 0x42);
+  check("rc after byte write", rd(ctx, 0x18, 4), 0x4200);
+
+  // w1c: writing 1 clears a bit, 0 leaves it
+  wr(ctx, 0x1C, 1, 0x0F);
+  check("w1c after clearing low nibble", rd(ctx, 0x1C, 1), 0xF0);
+  wr(ctx, 0x1C, 1, 0x00);
+  check("w1c after writing 0", rd(ctx, 0x1C, 1), 0xF0);
+
+  // fifo: reads pop in order, 0 when empty, writes push
+  check("fifo pop 1", rd(ctx, 0x20, 1), 1);
+  check("fifo pop 2", rd(ctx, 0x20, 1), 2);
+  check("fifo pop 3", rd(ctx, 0x20, 1), 3);
+  check("fifo empty", rd(ctx, 0x20, 1), 0);
+  wr(ctx, 0x20, 1, 7);
+  wr(ctx, 0x20, 1, 8);
+  check("fifo pushed 7", rd(ctx, 0x20, 1), 7);
+  check("fifo pushed 8", rd(ctx, 0x20, 1), 8);
+
+  // counter: every read returns the value, then adds step
+  check("counter start", rd(ctx, 0x24, 2), 5);
+  check("counter step 1", rd(ctx, 0x24, 2), 7);
+  check("counter step 2", rd(ctx, 0x24, 2), 9);
+  wr(ctx, 0x24, 2, 0xFFFF);
+  check("counter written", rd(ctx, 0x24, 2), 0xFFFF);
+  check("counter wraps at width", rd(ctx, 0x24, 2), 1);
+
+  // after: first n accesses (reads or writes) see the old value
+  check("after access 1", rd(ctx, 0x28, 1), 0);
+  wr(ctx, 0x28, 1, 0x55);
+  check("after access 3", rd(ctx, 0x28, 1), 0);
+  check("after switched", rd(ctx, 0x28, 1), 1);
+  check("after stays", rd(ctx, 0x28, 1), 1);
+
+  // Nothing declared there, and a gap between registers
+  if (!io_ctx_read(ctx, 0x2C, 1, &val) || !io_ctx_write(ctx, 0x16, 1, 0) ||
+      !io_ctx_probe(ctx, 0x200, 4)) {
+    fprintf(stderr, "FAIL access to an undeclared address succeeded\n");
+    failures++;
+  }
+  check("probe inside register", (uint32_t)io_ctx_probe(ctx, 0x13, 1), 0);
+}
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Every access to a "latency pcie" register costs at least the preset
+static void test_latency(io_ctx_t *ctx)
+{
+  io_op_t ops[LATENCY_READS + 1];
+  io_result_t res[LATENCY_READS + 1];
+
+  ops[0] = (io_op_t){ .op = IO_OP_WRITE, .size = 4, .addr = 0x100, .value = 0x5A5A };
+  for (int i = 1; i <= LATENCY_READS; i++)
+    ops[i] = (io_op_t){ .op = IO_OP_READ, .size = 4, .addr = 0x100 };
+
+  uint64_t start = now_ns();
+  size_t done = io_batch(ctx, ops, LATENCY_READS + 1, res);
+  uint64_t elapsed = now_ns() - start;
+
+  check("latency batch completed", (uint32_t)done, LATENCY_READS + 1);
+  check("latency batch read back", res[LATENCY_READS].value, 0x5A5A);
+  if (elapsed < (uint64_t)LATENCY_READS * PCIE_READ_NS + PCIE_WRITE_NS) {
+    fprintf(stderr, "FAIL pcie latency: batch of %d accesses took %llu ns\n",
+      LATENCY_READS + 1, (unsigned long long)elapsed);
+    failures++;
+  }
+}
+
+static void expect_rejected(const char *what, const char *text)
+{
+  io_ctx_t *ctx = open_model(text);
+
+  if (ctx) {
+    fprintf(stderr, "FAIL config accepted: %s\n", what);
+    failures++;
+    io_ctx_close(ctx);
+  }
+}
+
+static void test_load_errors(void)
+{
+  size_t fifo_len = 16 + 257 * 2 + 2;
+  char *fifo = malloc(fifo_len);
+  char *long_line = malloc(9000 + 2);
+
+  expect_rejected("duplicate register", "reg 0x10 1 rw 0\nreg 0x10 1 rw 1\n");
+  expect_rejected("overlapping register", "reg 0x10 4 rw 0\nreg 0x12 1 rw 1\n");
+  expect_rejected("overflowing number", "reg 0x10 1 rw 0x1FFFFFFFFFFFFFFFFFFFF\n");
+  expect_rejected("value wider than register", "reg 0x10 1 rw 0x100\n");
+  expect_rejected("fifo entry wider than register", "reg 0x10 2 fifo 1 0x10000\n");
+  expect_rejected("after state wider than register", "reg 0x10 1 after 2 0 0x100\n");
+  expect_rejected("extra rw arguments", "reg 0x10 1 rw 1 2 3 4 5\n");
+  expect_rejected("extra counter arguments", "reg 0x10 1 counter 1 2 3\n");
+  expect_rejected("extra after arguments", "reg 0x10 1 after 1 2 3 4\n");
+  expect_rejected("missing after arguments", "reg 0x10 1 after 1 2\n");
+  expect_rejected("bad width", "reg 0x10 3 rw 0\n");
+  expect_rejected("unknown kind", "reg 0x10 1 wo 0\n");
+  expect_rejected("unknown statement", "register 0x10 1 rw 0\n");
+  expect_rejected("latency preset with value", "latency pcie 10\n");
+  expect_rejected("negative latency", "latency -5\n");
+
+  if (fifo && long_line) {
+    size_t n = (size_t)sprintf(fifo, "reg 0x10 1 fifo");
+    for (int i = 0; i < 257; i++)
+      n += (size_t)sprintf(fifo + n, " 1");
+    strcpy(fifo + n, "\n");
+    expect_rejected("fifo overflow", fifo);
+
+    memset(long_line, ' ', 9000);
+    memcpy(long_line, "reg 0x10 1 rw 0", 15);
+    strcpy(long_line + 9000, "\n");
+    expect_rejected("line too long", long_line);
+  }
+  free(fifo);
+  free(long_line);
+}
+
+int main(void)
+{
+  io_ctx_t *ctx = open_model(model);
+
+  if (!ctx) {
+    fprintf(stderr, "FAIL model did not load\n");
+    return 1;
+  }
+  test_kinds(ctx);
+  test_latency(ctx);
+  io_ctx_close(ctx);
+  test_load_errors();
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("sim_model: all checks passed\n");
+  return 0;
+}